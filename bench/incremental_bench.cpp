@@ -0,0 +1,60 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "lib/Bytecode.h"
+#include "lib/IncrementalCompiler.h"
+
+// Re-analysis after a one-line edit of a large script, the editor case:
+// a full lex and compile against IncrementalCompiler::Edit for an edit that
+// keeps the line count, one that inserts a line and one that opens a
+// string literal running to the end of the script.
+
+static constexpr size_t kLines = 50000;
+static constexpr int kEdits = 200;
+
+static auto make_script() -> std::string {
+    std::string code;
+    for (size_t i = 0; i < kLines; i += 5) {
+        std::string n = std::to_string(i);
+        code += "f" + n + " = function(x)\n";
+        code += "    if x > " + n + " then return x * 2 end if\n";
+        code += "    return x + \"" + n + "\"\n";
+        code += "end function\n";
+        code += "v" + n + " = f" + n + "(" + n + ")\n";
+    }
+    return code;
+}
+
+template <typename F>
+static void measure(std::string_view name, int repeats, F&& body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; ++i) {
+        body(i);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << elapsed.count() / repeats << " us\n";
+}
+
+int main() {
+    std::string code = make_script();
+
+    measure("full lex + compile", 5, [&code](int) { CompiledProgram::Compile(code); });
+
+    IncrementalCompiler compiler(code);
+    size_t middle = kLines / 2;
+    measure("edit within a line", kEdits, [&compiler, middle](int i) {
+        compiler.Edit(middle + 4, middle + 5, "v" + std::to_string(i) + " = f0(" + std::to_string(i) + ")\n");
+    });
+    measure("insert a line", kEdits, [&compiler, middle](int) { compiler.Edit(middle, middle, "x = 1\n"); });
+    measure("open a string (to the end)", 5, [&compiler, middle](int) {
+        compiler.Edit(middle, middle + 1, "s = \"\n");
+        compiler.Edit(middle, middle + 1, "s = 1\n");
+    });
+    measure("link program", 5, [&compiler](int) { compiler.GetProgram(); });
+
+    return 0;
+}
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lib/Bytecode.h"
+#include "lib/Compiler.h"
+#include "lib/Lexer.h"
+#include "lib/WorkStealingPool.h"
+#include "lib/interpreter.h"
+
+// Front-end and VM throughput on synthetic corpora, examples/*.is and the
+// workloads in bench/workloads. Results are JSON, one benchmark per line,
+// so a run can be saved as a baseline and later runs diffed against it.
+//
+// The compiler parses and emits bytecode in one pass, so "compile" covers
+// both; "frontend" is source to program, what running a script pays.
+
+namespace fs = std::filesystem;
+
+struct Source {
+    std::string name;
+    std::string code;
+    // Corpora are only lexed and compiled.
+    bool runnable = false;
+};
+
+struct Result {
+    std::string name;
+    double ms = 0;
+    size_t iterations = 0;
+    double throughput = 0;
+    std::string unit;
+};
+
+struct Options {
+    std::vector<size_t> corpus_lines = {2000, 50000};
+    std::chrono::milliseconds min_time{300};
+    std::string filter;
+    fs::path output;
+    fs::path baseline;
+    double threshold = 0.1;
+    fs::path corpus_dir;
+    size_t jobs = std::thread::hardware_concurrency();
+};
+
+static void print_usage(const char* name) {
+    std::cerr << "Usage: " << name << " [--lines N[,N...]] [--min-time MS] [--filter TEXT] [--jobs N]\n"
+              << "       " << std::string(std::strlen(name), ' ')
+              << " [--output FILE] [--baseline FILE] [--threshold FRACTION] [--write-corpus DIR]\n";
+}
+
+static auto make_corpus(size_t lines) -> std::string {
+    std::mt19937 random(static_cast<unsigned>(lines));
+    std::string code;
+    size_t rows = 0;
+
+    for (size_t n = 0; rows < lines; ++n) {
+        std::string id = std::to_string(n);
+        std::string k = std::to_string(1 + random() % 100);
+        switch (random() % 4) {
+            case 0:
+                code += "f" + id + " = function(a, b)\n"
+                        "    // helper " + id + "\n"
+                        "    if a > b then\n"
+                        "        return a * 2 + b ^ 2 - " + k + "\n"
+                        "    else\n"
+                        "        return \"s" + id + " \\\"q\\\"\" + to_string(a)\n"
+                        "    end if\n"
+                        "end function\n";
+                rows += 8;
+                break;
+            case 1:
+                code += "acc" + id + " = 0\n"
+                        "for i in range(" + k + ")\n"
+                        "    acc" + id + " += i % 7 - 1.5e2\n"
+                        "end for\n";
+                rows += 4;
+                break;
+            case 2:
+                code += "l" + id + " = [1, 2.5, \"three\", nil, true][1:" + k + "]\n";
+                rows += 1;
+                break;
+            default:
+                code += "w" + id + " = " + k + "\n"
+                        "while w" + id + " > 0 and not (w" + id + " == 3)\n"
+                        "    w" + id + " -= 1\n"
+                        "end while\n";
+                rows += 4;
+                break;
+        }
+    }
+
+    return code;
+}
+
+static auto read_file(const fs::path& path) -> std::string {
+    std::ifstream file(path);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+static void add_scripts(std::vector<Source>& sources, const fs::path& dir, std::string_view prefix) {
+    std::vector<fs::path> paths;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.path().extension() == ".is") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    for (const auto& path : paths) {
+        sources.push_back({std::string(prefix) + path.stem().string(), read_file(path), true});
+    }
+}
+
+// Median time of one run of `body`, repeated for at least `min_time`.
+template <typename F>
+static auto measure(std::string name, std::chrono::milliseconds min_time, F&& body) -> Result {
+    body();
+
+    std::vector<double> times;
+    auto start = std::chrono::steady_clock::now();
+    do {
+        auto begin = std::chrono::steady_clock::now();
+        body();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+    } while (times.size() < 3 || std::chrono::steady_clock::now() - start < min_time);
+
+    std::nth_element(times.begin(), times.begin() + static_cast<ptrdiff_t>(times.size() / 2), times.end());
+    return {std::move(name), times[times.size() / 2], times.size(), 0, {}};
+}
+
+static void run_source(const Source& source, const Options& options, WorkStealingPool& pool,
+                       std::vector<Result>& results) {
+    auto wanted = [&options](const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    };
+
+    Lexer lexer;
+    lexer.LoadCode(source.code);
+    lexer.Parse();
+    const auto& tokens = lexer.GetTokens();
+    auto per_second = [](size_t count, double ms) { return static_cast<double>(count) / ms * 1e3; };
+
+    if (std::string name = "lex/" + source.name; wanted(name)) {
+        Result result = measure(name, options.min_time, [&source] {
+            Lexer lexer;
+            lexer.LoadCode(source.code);
+            lexer.Parse();
+        });
+        result.throughput = per_second(tokens.size(), result.ms);
+        result.unit = "tokens/s";
+        results.push_back(std::move(result));
+    }
+
+    // Only the corpora are big enough to be cut into chunks.
+    if (std::string name = "lex_parallel/" + source.name; !source.runnable && wanted(name)) {
+        Result result = measure(name, options.min_time, [&source, &pool] {
+            Lexer lexer;
+            lexer.SetWorkerPool(&pool);
+            lexer.LoadCode(source.code);
+            lexer.Parse();
+        });
+        result.throughput = per_second(tokens.size(), result.ms);
+        result.unit = "tokens/s";
+        results.push_back(std::move(result));
+    }
+
+    if (std::string name = "compile/" + source.name; wanted(name)) {
+        Result result = measure(name, options.min_time, [&tokens] { Compiler(tokens).Compile(); });
+        result.throughput = per_second(tokens.size(), result.ms);
+        result.unit = "tokens/s";
+        results.push_back(std::move(result));
+    }
+
+    if (std::string name = "frontend/" + source.name; wanted(name)) {
+        Result result = measure(name, options.min_time, [&source] { CompiledProgram::Compile(source.code); });
+        result.throughput = per_second(source.code.size(), result.ms);
+        result.unit = "bytes/s";
+        results.push_back(std::move(result));
+    }
+
+    if (std::string name = "execute/" + source.name; source.runnable && wanted(name)) {
+        auto program = CompiledProgram::Compile(source.code);
+        std::string error;
+        Result result = measure(name, options.min_time, [&program, &error] {
+            std::istringstream input;
+            std::ostringstream output;
+            Interpreter interpreter(program, input, output);
+            if (!interpreter.Run()) {
+                error = interpreter.GetError();
+            }
+        });
+        if (!error.empty()) {
+            std::cerr << name << ": " << error << '\n';
+            return;
+        }
+        results.push_back(std::move(result));
+    }
+}
+
+static void write_json(std::ostream& out, const std::vector<Result>& results, const Options& options) {
+#ifdef __OPTIMIZE__
+    constexpr bool kOptimized = true;
+#else
+    constexpr bool kOptimized = false;
+#endif
+
+    out << "{\n"
+        << "  \"optimized\": " << (kOptimized ? "true" : "false") << ",\n"
+        << "  \"min_time_ms\": " << options.min_time.count() << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        out << "    {\"name\": \"" << result.name << "\", \"ms\": " << std::fixed << std::setprecision(6) << result.ms
+            << ", \"iterations\": " << result.iterations;
+        if (!result.unit.empty()) {
+            out << ", \"throughput\": " << std::setprecision(0) << result.throughput << ", \"unit\": \""
+                << result.unit << '"';
+        }
+        out << '}' << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    out << "  ]\n"
+        << "}\n";
+}
+
+// Reads back what write_json wrote: name and time of every result line.
+static auto read_baseline(const fs::path& path) -> std::map<std::string, double> {
+    std::map<std::string, double> times;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t ms = line.find("\"ms\": ");
+        if (name == std::string::npos || ms == std::string::npos) {
+            continue;
+        }
+        name += 9;
+        times[line.substr(name, line.find('"', name) - name)] = std::stod(line.substr(ms + 6));
+    }
+
+    return times;
+}
+
+// Prints how every result moved against the baseline. Returns the number
+// of regressions: results slower than the baseline by more than the
+// threshold.
+static auto compare(const std::vector<Result>& results, const Options& options) -> size_t {
+    auto baseline = read_baseline(options.baseline);
+    if (baseline.empty()) {
+        std::cerr << "No results in baseline " << options.baseline << '\n';
+        return 0;
+    }
+
+    size_t regressions = 0;
+    std::cerr << std::fixed << std::setprecision(3);
+    for (const Result& result : results) {
+        std::cerr << std::left << std::setw(40) << result.name << std::right;
+        auto it = baseline.find(result.name);
+        if (it == baseline.end()) {
+            std::cerr << std::setw(12) << result.ms << " ms  (new)\n";
+            continue;
+        }
+
+        double change = result.ms / it->second - 1;
+        std::cerr << std::setw(12) << it->second << " -> " << std::setw(12) << result.ms << " ms  " << std::showpos
+                  << std::setprecision(1) << change * 100 << '%' << std::noshowpos << std::setprecision(3);
+        if (change > options.threshold) {
+            std::cerr << "  REGRESSION";
+            ++regressions;
+        } else if (change < -options.threshold) {
+            std::cerr << "  improved";
+        }
+        std::cerr << '\n';
+    }
+
+    return regressions;
+}
+
+static auto parse_lines(std::string_view list) -> std::vector<size_t> {
+    std::vector<size_t> lines;
+    std::istringstream stream{std::string(list)};
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        lines.push_back(std::stoul(item));
+    }
+
+    return lines;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            if (i + 1 >= argc) {
+                print_usage(argv[0]);
+                return 1;
+            }
+
+            std::string value = argv[++i];
+            if (arg == "--lines") {
+                options.corpus_lines = parse_lines(value);
+            } else if (arg == "--min-time") {
+                options.min_time = std::chrono::milliseconds(std::stoul(value));
+            } else if (arg == "--filter") {
+                options.filter = value;
+            } else if (arg == "--jobs") {
+                options.jobs = std::stoul(value);
+            } else if (arg == "--output") {
+                options.output = value;
+            } else if (arg == "--baseline") {
+                options.baseline = value;
+            } else if (arg == "--threshold") {
+                options.threshold = std::stod(value);
+            } else if (arg == "--write-corpus") {
+                options.corpus_dir = value;
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+#ifndef __OPTIMIZE__
+    std::cerr << "warning: unoptimized build, configure with -DCMAKE_BUILD_TYPE=Release\n";
+#endif
+
+    std::vector<Source> sources;
+    for (size_t lines : options.corpus_lines) {
+        sources.push_back({"corpus_" + std::to_string(lines), make_corpus(lines)});
+        if (!options.corpus_dir.empty()) {
+            fs::create_directories(options.corpus_dir);
+            std::ofstream(options.corpus_dir / (sources.back().name + ".is")) << sources.back().code;
+        }
+    }
+    add_scripts(sources, ITMOSCRIPT_EXAMPLES_DIR, "examples/");
+    add_scripts(sources, ITMOSCRIPT_WORKLOADS_DIR, "workloads/");
+
+    WorkStealingPool pool(std::max<size_t>(options.jobs, 1));
+    std::vector<Result> results;
+    for (const Source& source : sources) {
+        try {
+            run_source(source, options, pool, results);
+        } catch (const SyntaxError& e) {
+            std::cerr << source.name << ": " << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    if (options.output.empty()) {
+        write_json(std::cout, results, options);
+    } else {
+        std::ofstream file(options.output);
+        write_json(file, results, options);
+    }
+
+    if (!options.baseline.empty() && compare(results, options) != 0) {
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "lib/Bytecode.h"
+#include "lib/interpreter.h"
+
+// List workloads run as whole scripts, so the numbers include the VM: a
+// queue fed at the back and drained from the front, a stack, and a deque
+// growing at the front. Each is sized so a linear-time remove(q, 0) or
+// insert(q, 0, x) would be obvious.
+
+static constexpr size_t kOperations = 200000;
+
+static void run(std::string_view name, const std::string& code) {
+    auto program = CompiledProgram::Compile(code);
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(program, input, output);
+
+    auto start = std::chrono::steady_clock::now();
+    if (!interpreter.Run()) {
+        std::cerr << name << ": " << interpreter.GetError() << '\n';
+        return;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << static_cast<double>(kOperations) / elapsed.count() / 1e6 << " Mops/s  ("
+              << output.str().substr(0, output.str().find('\n')) << ")\n";
+}
+
+int main() {
+    std::string n = std::to_string(kOperations);
+
+    // Keeps a large backlog so each remove(q, 0) would shift it all.
+    run("queue", R"(
+        q = range(50000)
+        sum = 0
+        for i in range()" + n + R"()
+            push(q, i)
+            sum += remove(q, 0)
+        end for
+        println(sum)
+    )");
+    run("stack", R"(
+        s = range(50000)
+        sum = 0
+        for i in range()" + n + R"()
+            push(s, i)
+            sum += pop(s)
+        end for
+        println(sum)
+    )");
+    run("deque (front insert)", R"(
+        d = []
+        for i in range()" + n + R"()
+            insert(d, 0, i)
+        end for
+        println(d[0])
+    )");
+    run("deque (both ends)", R"(
+        d = range(50000)
+        sum = 0
+        for i in range()" + n + R"()
+            insert(d, 0, i)
+            sum += pop(d)
+        end for
+        println(sum)
+    )");
+
+    return 0;
+}
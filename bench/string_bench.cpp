@@ -0,0 +1,101 @@
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lib/Builtins.h"
+#include "lib/Bytecode.h"
+#include "lib/interpreter.h"
+
+// Throughput of the string built-ins, called directly with prepared
+// arguments so only the built-in itself is measured.
+
+static constexpr size_t kTextSize = 16 * 1024 * 1024;
+static constexpr auto kMinDuration = std::chrono::milliseconds(300);
+
+static auto find_builtin(std::string_view name) -> const BuiltinFunction& {
+    for (const auto& builtin : GetBuiltins()) {
+        if (builtin.name == name) {
+            return builtin;
+        }
+    }
+
+    throw std::runtime_error("no built-in " + std::string(name));
+}
+
+// Mostly lowercase words with some capitals and punctuation, one line per
+// ~80 bytes.
+static auto make_text(size_t size) -> std::string {
+    static constexpr std::string_view kAlphabet = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJ,.;";
+    std::mt19937 random(239);
+    std::string text;
+    text.reserve(size);
+    while (text.size() < size) {
+        size_t word = 2 + random() % 9;
+        for (size_t i = 0; i < word; ++i) {
+            text += kAlphabet[random() % kAlphabet.size()];
+        }
+        text += (random() % 10 == 0) ? '\n' : ' ';
+    }
+    text.resize(size);
+
+    return text;
+}
+
+static void measure(std::string_view name, size_t bytes, const std::function<void()>& body) {
+    size_t iterations = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{};
+    do {
+        body();
+        ++iterations;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < kMinDuration);
+
+    double gigabytes = static_cast<double>(bytes * iterations) / 1e9;
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << gigabytes / elapsed.count() << " GB/s\n";
+}
+
+static void bench(Interpreter& interpreter, std::string_view name, std::string_view label, std::vector<Value> args,
+                  size_t bytes) {
+    const BuiltinFunction& builtin = find_builtin(name);
+    measure(label, bytes, [&] { builtin.impl(interpreter, args); });
+}
+
+int main() {
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile(""), input, output);
+
+    std::string text = make_text(kTextSize);
+    Value str = MakeString(text);
+
+    std::pmr::vector<Value> words;
+    size_t words_size = 0;
+    {
+        std::istringstream stream(text);
+        std::string word;
+        while (stream >> word) {
+            words_size += word.size() + 1;
+            words.push_back(MakeString(std::move(word)));
+        }
+    }
+    Value word_list = MakeList(std::move(words));
+
+    bench(interpreter, "len", "len", {str}, kTextSize);
+    bench(interpreter, "lower", "lower", {str}, kTextSize);
+    bench(interpreter, "upper", "upper", {str}, kTextSize);
+    bench(interpreter, "split", "split (\\n)", {str, MakeString("\n")}, kTextSize);
+    bench(interpreter, "split", "split (\", \")", {str, MakeString(", ")}, kTextSize);
+    bench(interpreter, "split", "split (no match)", {str, MakeString("#%")}, kTextSize);
+    bench(interpreter, "replace", "replace (\"ab\")", {str, MakeString("ab"), MakeString("AB")}, kTextSize);
+    bench(interpreter, "replace", "replace (no match)", {str, MakeString("zzzzz"), MakeString("")}, kTextSize);
+    bench(interpreter, "join", "join", {word_list, MakeString(" ")}, words_size);
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "BatchRunner.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <memory_resource>
+#include <sstream>
+
+#include "lib/Compiler.h"
+#include "lib/WorkStealingPool.h"
+#include "lib/interpreter.h"
+
+namespace fs = std::filesystem;
+
+auto CollectScripts(const std::vector<fs::path>& paths, const std::vector<fs::path>& list_files) -> std::vector<fs::path> {
+    std::vector<fs::path> scripts;
+
+    auto add = [&scripts](const fs::path& path) {
+        if (!fs::is_directory(path)) {
+            scripts.push_back(path);
+            return;
+        }
+        for (const auto& entry : fs::recursive_directory_iterator(path)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".is") {
+                scripts.push_back(entry.path());
+            }
+        }
+    };
+
+    for (const auto& path : paths) {
+        add(path);
+    }
+    for (const auto& list_file : list_files) {
+        std::ifstream list(list_file);
+        std::string line;
+        while (std::getline(list, line)) {
+            if (!line.empty()) {
+                add(line);
+            }
+        }
+    }
+
+    std::sort(scripts.begin(), scripts.end());
+    scripts.erase(std::unique(scripts.begin(), scripts.end()), scripts.end());
+    return scripts;
+}
+
+static auto output_path(const fs::path& script, const fs::path& output_dir) -> fs::path {
+    fs::path output = script;
+    output.replace_extension(".out");
+    if (output_dir.empty()) {
+        return output;
+    }
+
+    return output_dir / output.filename();
+}
+
+static auto read_file(const fs::path& path, std::string& contents) -> bool {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// I/O of a script in flight. Input is read up front and output is kept in
+// memory until the script is done, so thousands of scripts do not hold
+// thousands of open files.
+struct ScriptIo {
+    std::istringstream input;
+    std::ostringstream output;
+};
+
+static void spawn_script(Scheduler& scheduler, const fs::path& script, const BatchOptions& options, ScriptIo& io,
+                         BatchResult& result) {
+    result.script = script;
+
+    std::string code;
+    if (!read_file(script, code)) {
+        result.error = "cannot open script";
+        return;
+    }
+
+    // One pool per script: compile scratch is reused by the script's values,
+    // and everything is released at once when the script is done.
+    auto pool = std::make_unique<std::pmr::unsynchronized_pool_resource>();
+
+    std::shared_ptr<const CompiledProgram> program;
+    try {
+        program = CompiledProgram::Compile(code, pool.get());
+    } catch (const SyntaxError& e) {
+        result.error = e.what();
+        return;
+    }
+
+    fs::path input_path = script;
+    input_path.replace_extension(".in");
+    std::string input;
+    if (read_file(input_path, input)) {
+        io.input.str(std::move(input));
+    }
+
+    fs::path output = output_path(script, options.output_dir);
+    scheduler.Spawn(std::move(program), io.input, io.output, options.limits,
+                    [&io, &result, output](const ScriptOutcome& outcome) {
+                        result.success = outcome.success;
+                        result.error = outcome.error;
+                        result.run_time = outcome.run_time;
+
+                        std::ofstream file(output);
+                        file << io.output.view();
+                        if (!file) {
+                            result.success = false;
+                            result.error = "cannot write output file";
+                        }
+                        io.output = std::ostringstream();
+                    },
+                    std::move(pool));
+}
+
+auto RunBatch(const BatchOptions& options) -> std::vector<BatchResult> {
+    if (!options.output_dir.empty()) {
+        fs::create_directories(options.output_dir);
+    }
+
+    std::vector<BatchResult> results(options.scripts.size());
+    std::vector<ScriptIo> io(options.scripts.size());
+    {
+        size_t jobs = options.jobs == 0 ? std::thread::hardware_concurrency() : options.jobs;
+        WorkStealingPool pool(jobs);
+        Scheduler scheduler(jobs);
+        scheduler.SetWorkerPool(&pool);
+        // Scripts are read and compiled on the pool, each spawned as soon as
+        // it is ready, so the front end runs in parallel with itself and with
+        // the scripts already running.
+        for (size_t i = 0; i < options.scripts.size(); ++i) {
+            pool.Submit([&scheduler, &options, &io, &results, i] {
+                spawn_script(scheduler, options.scripts[i], options, io[i], results[i]);
+            });
+        }
+        pool.Wait();
+        scheduler.Wait();
+    }
+
+    return results;
+}
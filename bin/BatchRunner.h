@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "lib/Scheduler.h"
+
+struct BatchOptions {
+    std::vector<std::filesystem::path> scripts;
+    std::filesystem::path output_dir;
+    size_t jobs = 0;
+    ScriptLimits limits;
+};
+
+struct BatchResult {
+    std::filesystem::path script;
+    bool success = false;
+    std::string error;
+    // Sum of the script's time slices: the time it spent running, not the
+    // wall-clock time from its start to its end, which includes waiting for
+    // its turn and for I/O.
+    std::chrono::duration<double, std::milli> run_time{};
+};
+
+// Expands directories (every *.is inside, recursively) and list files
+// (one path per line) into a flat, sorted list of scripts.
+auto CollectScripts(const std::vector<std::filesystem::path>& paths,
+                    const std::vector<std::filesystem::path>& list_files) -> std::vector<std::filesystem::path>;
+
+// Runs every script on a Scheduler, interleaving them in time slices. Script
+// `x.is` reads from `x.in` when it exists and writes to `x.out` (inside
+// output_dir when it is set) once it is done.
+auto RunBatch(const BatchOptions& options) -> std::vector<BatchResult>;
@@ -1,6 +1,166 @@
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <string_view>
+
+#include "BatchRunner.h"
+#include "lib/Compiler.h"
+#include "lib/Profiler.h"
+#include "lib/WorkStealingPool.h"
+#include "lib/interpreter.h"
+
+static void print_usage(const char* name) {
+    std::cerr << "Usage: " << name << " [--profile FILE] [--profile-interval N] <script.is>\n"
+              << "       " << name << " [--jobs N] [--output-dir DIR] [--list FILE]\n"
+              << "       " << std::string(std::strlen(name), ' ')
+              << " [--time-slice N] [--max-instructions N] [--max-memory BYTES] <script.is | dir>...\n";
+}
+
+// The whole of `text` must be a non-negative integer that fits in size_t.
+static bool parse_count(std::string_view text, size_t& value) {
+    const char* end = text.data() + text.size();
+    auto [ptr, error] = std::from_chars(text.data(), end, value);
+    return !text.empty() && error == std::errc() && ptr == end;
+}
+
+struct ProfileOptions {
+    // Collapsed stacks go here; the per-line table goes to stderr.
+    std::string output;
+    size_t interval = Profiler::kDefaultInterval;
+};
+
+static int run_single(const std::string& path, const ProfileOptions& profile) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return 1;
+    }
+    std::string code{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    WorkStealingPool pool;
+    std::shared_ptr<const CompiledProgram> program;
+    try {
+        program = CompiledProgram::Compile(code, std::pmr::get_default_resource(), &pool);
+    } catch (const SyntaxError& e) {
+        std::cerr << path << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Lets read() pull whole buffered chunks from stdin instead of going
+    // through C stdio one character at a time.
+    std::ios::sync_with_stdio(false);
+
+    Interpreter interpreter(program, std::cin, std::cout);
+    interpreter.SetWorkerPool(&pool);
+    Profiler profiler;
+    if (!profile.output.empty()) {
+        interpreter.SetProfiler(&profiler, profile.interval);
+    }
+
+    bool success = interpreter.Run();
+    std::cout.flush();
+    if (!success) {
+        std::cerr << path << ": " << interpreter.GetError() << std::endl;
+    }
+
+    if (!profile.output.empty()) {
+        std::ofstream stacks(profile.output);
+        profiler.WriteCollapsed(stacks);
+        std::cerr << profiler.GetSampleCount() << " samples, every ~" << profile.interval
+                  << " instructions; stacks written to " << profile.output << '\n';
+        profiler.WriteLineTable(std::cerr);
+    }
+
+    return success ? 0 : 1;
+}
+
+static int run_batch(const BatchOptions& options) {
+    auto start = std::chrono::steady_clock::now();
+    auto results = RunBatch(options);
+    std::chrono::duration<double, std::milli> total = std::chrono::steady_clock::now() - start;
+
+    size_t failed = 0;
+    std::cout << std::fixed << std::setprecision(3);
+    for (const auto& result : results) {
+        std::cout << (result.success ? "OK  " : "FAIL") << ' ' << std::setw(12) << result.run_time.count()
+                  << " ms run  " << result.script.string() << '\n';
+        if (!result.success) {
+            ++failed;
+            std::cout << "    " << result.error << '\n';
+        }
+    }
+    std::cout << results.size() << " scripts, " << failed << " failed, " << total.count() << " ms total" << std::endl;
+
+    return failed == 0 ? 0 : 1;
+}
 
 int main(int argc, char** argv) {
-    std::cout << "Hello, world!" << std::endl;
-    return 0;
-}
\ No newline at end of file
+    BatchOptions options;
+    ProfileOptions profile;
+    std::vector<std::filesystem::path> paths;
+    std::vector<std::filesystem::path> list_files;
+    bool batch = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+        bool bad_value = false;
+        auto read_count = [&](size_t& value) {
+            bad_value = !parse_count(argv[++i], value);
+        };
+
+        if (arg == "--jobs" && has_value) {
+            read_count(options.jobs);
+            batch = true;
+        } else if (arg == "--output-dir" && has_value) {
+            options.output_dir = argv[++i];
+            batch = true;
+        } else if (arg == "--time-slice" && has_value) {
+            read_count(options.limits.time_slice);
+            batch = true;
+        } else if (arg == "--max-instructions" && has_value) {
+            read_count(options.limits.max_instructions);
+            batch = true;
+        } else if (arg == "--max-memory" && has_value) {
+            read_count(options.limits.max_memory);
+            batch = true;
+        } else if (arg == "--profile" && has_value) {
+            profile.output = argv[++i];
+        } else if (arg == "--profile-interval" && has_value) {
+            read_count(profile.interval);
+        } else if (arg == "--list" && has_value) {
+            list_files.emplace_back(argv[++i]);
+            batch = true;
+        } else if (arg.starts_with("--")) {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            paths.emplace_back(arg);
+        }
+
+        if (bad_value) {
+            std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (paths.empty() && list_files.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (!batch && paths.size() == 1 && !std::filesystem::is_directory(paths.front())) {
+        return run_single(paths.front().string(), profile);
+    }
+    if (!profile.output.empty()) {
+        std::cerr << "--profile runs a single script" << std::endl;
+        return 1;
+    }
+
+    options.scripts = CollectScripts(paths, list_files);
+    return run_batch(options);
+}
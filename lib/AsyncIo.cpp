@@ -0,0 +1,174 @@
+#include "AsyncIo.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+static constexpr size_t kReadChunk = 64 * 1024;
+
+static void set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags != -1) {
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+}
+
+void WaitUntilReady(const IoWait& wait) {
+    pollfd descriptor{wait.fd, static_cast<short>(wait.write ? POLLOUT : POLLIN), 0};
+    while (poll(&descriptor, 1, -1) == -1 && errno == EINTR) {
+    }
+}
+
+AsyncInput::AsyncInput(int fd)
+    : fd_(fd) {
+    set_non_blocking(fd);
+    setg(buffer_.data(), buffer_.data(), buffer_.data());
+}
+
+auto AsyncInput::GetFd() const noexcept -> int {
+    return fd_;
+}
+
+bool AsyncInput::Fill() {
+    if (eof_) {
+        return false;
+    }
+
+    buffer_.erase(0, static_cast<size_t>(gptr() - eback()));
+    size_t old_size = buffer_.size();
+
+    while (true) {
+        size_t size = buffer_.size();
+        buffer_.resize(size + kReadChunk);
+        ssize_t count = ::read(fd_, buffer_.data() + size, kReadChunk);
+        buffer_.resize(size + (count > 0 ? static_cast<size_t>(count) : 0));
+
+        if (count > 0) {
+            if (static_cast<size_t>(count) < kReadChunk) {
+                break;
+            }
+            continue;
+        }
+        if (count == -1 && errno == EINTR) {
+            continue;
+        }
+        if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            eof_ = true;
+        }
+        break;
+    }
+
+    setg(buffer_.data(), buffer_.data(), buffer_.data() + buffer_.size());
+    return buffer_.size() != old_size || eof_;
+}
+
+bool AsyncInput::HasLine() const noexcept {
+    return eof_ || std::memchr(gptr(), '\n', static_cast<size_t>(egptr() - gptr())) != nullptr;
+}
+
+bool AsyncInput::IsComplete() const noexcept {
+    return eof_;
+}
+
+void AsyncInput::WaitForLine() {
+    while (!HasLine()) {
+        if (!Fill()) {
+            WaitUntilReady({fd_, false});
+        }
+    }
+}
+
+void AsyncInput::WaitForEnd() {
+    while (!eof_) {
+        if (!Fill()) {
+            WaitUntilReady({fd_, false});
+        }
+    }
+}
+
+auto AsyncInput::underflow() -> int_type {
+    while (gptr() == egptr() && !eof_) {
+        if (!Fill()) {
+            WaitUntilReady({fd_, false});
+        }
+    }
+
+    return gptr() == egptr() ? traits_type::eof() : traits_type::to_int_type(*gptr());
+}
+
+AsyncOutput::AsyncOutput(int fd, size_t high_water)
+    : fd_(fd)
+    , high_water_(high_water) {
+    set_non_blocking(fd);
+}
+
+AsyncOutput::~AsyncOutput() {
+    Drain();
+}
+
+auto AsyncOutput::GetFd() const noexcept -> int {
+    return fd_;
+}
+
+bool AsyncOutput::Flush() {
+    while (written_ < pending_.size() && !failed_) {
+        ssize_t count = ::write(fd_, pending_.data() + written_, pending_.size() - written_);
+        if (count > 0) {
+            written_ += static_cast<size_t>(count);
+        } else if (count == -1 && errno == EINTR) {
+            continue;
+        } else if (count == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return false;
+        } else {
+            // The reader is gone; drop the output like a closed pipe would.
+            failed_ = true;
+        }
+    }
+
+    pending_.clear();
+    written_ = 0;
+    return true;
+}
+
+void AsyncOutput::Drain() {
+    while (!Flush()) {
+        WaitUntilReady({fd_, true});
+    }
+}
+
+bool AsyncOutput::HasPending() const noexcept {
+    return written_ < pending_.size();
+}
+
+bool AsyncOutput::IsCongested() const noexcept {
+    return pending_.size() - written_ >= high_water_;
+}
+
+auto AsyncOutput::overflow(int_type ch) -> int_type {
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        char c = traits_type::to_char_type(ch);
+        Append(&c, 1);
+    }
+
+    return traits_type::not_eof(ch);
+}
+
+auto AsyncOutput::xsputn(const char* data, std::streamsize size) -> std::streamsize {
+    Append(data, static_cast<size_t>(size));
+    return size;
+}
+
+auto AsyncOutput::sync() -> int {
+    Flush();
+    return 0;
+}
+
+void AsyncOutput::Append(const char* data, size_t size) {
+    pending_.append(data, size);
+    if (IsCongested()) {
+        Flush();
+    }
+}
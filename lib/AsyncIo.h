@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <streambuf>
+#include <string>
+
+// Descriptor a suspended script waits on before it can make progress.
+struct IoWait {
+    int fd = -1;
+    bool write = false;
+};
+
+// Blocks the calling thread until the descriptor is ready.
+void WaitUntilReady(const IoWait& wait);
+
+// Input stream buffer over a non-blocking descriptor (pipe, socket, tty or
+// file). It only hands out bytes that have already arrived, so read() can
+// ask HasLine() first and suspend the script instead of the thread. Plain
+// istream use still works: an empty buffer then waits for data.
+class AsyncInput : public std::streambuf {
+public:
+    explicit AsyncInput(int fd);
+
+    auto GetFd() const noexcept -> int;
+
+    // Reads whatever the descriptor has right now. Returns false if nothing
+    // new arrived.
+    bool Fill();
+
+    // True when a whole line, or the rest of the input, is buffered.
+    bool HasLine() const noexcept;
+    // True once the end of the input has been seen.
+    bool IsComplete() const noexcept;
+
+    void WaitForLine();
+    void WaitForEnd();
+
+protected:
+    auto underflow() -> int_type override;
+
+private:
+    int fd_;
+    std::string buffer_;
+    bool eof_ = false;
+};
+
+// Output stream buffer over a non-blocking descriptor. Writes are queued in
+// memory and pushed out whenever the descriptor accepts them; a script that
+// queued more than the high-water mark waits until the reader catches up.
+class AsyncOutput : public std::streambuf {
+public:
+    static constexpr size_t kDefaultHighWater = 64 * 1024;
+
+    explicit AsyncOutput(int fd, size_t high_water = kDefaultHighWater);
+    ~AsyncOutput() override;
+
+    auto GetFd() const noexcept -> int;
+
+    // Writes as much as the descriptor takes without blocking. Returns true
+    // when nothing is left queued.
+    bool Flush();
+    void Drain();
+
+    bool HasPending() const noexcept;
+    bool IsCongested() const noexcept;
+
+protected:
+    auto overflow(int_type ch) -> int_type override;
+    auto xsputn(const char* data, std::streamsize size) -> std::streamsize override;
+    auto sync() -> int override;
+
+private:
+    int fd_;
+    size_t high_water_;
+    std::string pending_;
+    size_t written_ = 0;
+    bool failed_ = false;
+
+    void Append(const char* data, size_t size);
+};
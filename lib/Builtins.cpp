@@ -0,0 +1,417 @@
+#include "Builtins.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "ParallelBuiltins.h"
+#include "StringAlgorithms.h"
+#include "interpreter.h"
+
+static auto expect_number(std::span<const Value> args, size_t index, std::string_view function) -> double {
+    const auto* number = std::get_if<double>(&args[index]);
+    if (number == nullptr) {
+        throw ScriptError(std::string(function) + "() expects a number as argument " + std::to_string(index + 1) +
+                          ", got " + std::string(TypeName(args[index])));
+    }
+
+    return *number;
+}
+
+static auto expect_string(std::span<const Value> args, size_t index, std::string_view function) -> std::string_view {
+    const auto* str = std::get_if<StringPtr>(&args[index]);
+    if (str == nullptr) {
+        throw ScriptError(std::string(function) + "() expects a string as argument " + std::to_string(index + 1) +
+                          ", got " + std::string(TypeName(args[index])));
+    }
+
+    return (*str)->GetText();
+}
+
+static auto expect_list(std::span<const Value> args, size_t index, std::string_view function) -> List& {
+    const auto* list = std::get_if<ListPtr>(&args[index]);
+    if (list == nullptr) {
+        throw ScriptError(std::string(function) + "() expects a list as argument " + std::to_string(index + 1) +
+                          ", got " + std::string(TypeName(args[index])));
+    }
+
+    return **list;
+}
+
+static auto expect_position(std::span<const Value> args, size_t index, size_t size, std::string_view function) -> size_t {
+    double number = expect_number(args, index, function);
+    if (std::floor(number) != number) {
+        throw ScriptError(std::string(function) + "() expects an integer index");
+    }
+
+    // Checked as a double first: casting inf or anything past long long is UB.
+    if (std::fabs(number) > static_cast<double>(size)) {
+        throw ScriptError(std::string(function) + "(): index out of range");
+    }
+
+    auto position = static_cast<long long>(number);
+    if (position < 0) {
+        position += static_cast<long long>(size);
+    }
+    if (position < 0 || position > static_cast<long long>(size)) {
+        throw ScriptError(std::string(function) + "(): index out of range");
+    }
+
+    return static_cast<size_t>(position);
+}
+
+// Numbers
+
+static auto builtin_abs(Interpreter&, std::span<const Value> args) -> Value {
+    return std::fabs(expect_number(args, 0, "abs"));
+}
+
+static auto builtin_ceil(Interpreter&, std::span<const Value> args) -> Value {
+    return std::ceil(expect_number(args, 0, "ceil"));
+}
+
+static auto builtin_floor(Interpreter&, std::span<const Value> args) -> Value {
+    return std::floor(expect_number(args, 0, "floor"));
+}
+
+static auto builtin_round(Interpreter&, std::span<const Value> args) -> Value {
+    return std::round(expect_number(args, 0, "round"));
+}
+
+static auto builtin_sqrt(Interpreter&, std::span<const Value> args) -> Value {
+    double number = expect_number(args, 0, "sqrt");
+    if (number < 0) {
+        throw ScriptError("sqrt() of a negative number");
+    }
+
+    return std::sqrt(number);
+}
+
+static auto builtin_rnd(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    interpreter.CheckSideEffect("rnd()");
+    double bound = expect_number(args, 0, "rnd");
+    if (!(bound >= 1)) {
+        throw ScriptError("rnd() expects a positive bound");
+    }
+    // 2^63, the first double past the range of long long.
+    if (bound >= 9223372036854775808.0) {
+        throw ScriptError("rnd() bound too large");
+    }
+
+    std::uniform_int_distribution<long long> distribution(0, static_cast<long long>(bound) - 1);
+    return static_cast<double>(distribution(interpreter.GetRandom()));
+}
+
+static auto builtin_parse_num(Interpreter&, std::span<const Value> args) -> Value {
+    const auto* str = std::get_if<StringPtr>(&args[0]);
+    if (str == nullptr) {
+        return Nil{};
+    }
+
+    // from_chars takes no leading '+', stod did.
+    std::string_view text = (*str)->GetText();
+    if (text.size() > 1 && text[0] == '+' && text[1] != '-' && text[1] != '+') {
+        text.remove_prefix(1);
+    }
+
+    double number;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        return Nil{};
+    }
+
+    return number;
+}
+
+static auto builtin_to_string(Interpreter&, std::span<const Value> args) -> Value {
+    return MakeString(ValueToString(args[0]));
+}
+
+// Strings
+
+static auto builtin_len(Interpreter&, std::span<const Value> args) -> Value {
+    if (const auto* str = std::get_if<StringPtr>(&args[0])) {
+        return static_cast<double>((*str)->GetLength());
+    }
+    if (const auto* list = std::get_if<ListPtr>(&args[0])) {
+        return static_cast<double>((*list)->GetSize());
+    }
+
+    throw ScriptError("len() expects a string or a list, got " + std::string(TypeName(args[0])));
+}
+
+static auto builtin_lower(Interpreter&, std::span<const Value> args) -> Value {
+    std::pmr::string result(expect_string(args, 0, "lower"), GetMemoryResource());
+    AsciiToLower(result.data(), result.size());
+    return MakeString(std::move(result));
+}
+
+static auto builtin_upper(Interpreter&, std::span<const Value> args) -> Value {
+    std::pmr::string result(expect_string(args, 0, "upper"), GetMemoryResource());
+    AsciiToUpper(result.data(), result.size());
+    return MakeString(std::move(result));
+}
+
+static auto builtin_split(Interpreter&, std::span<const Value> args) -> Value {
+    std::string_view str = expect_string(args, 0, "split");
+    std::string_view delim = expect_string(args, 1, "split");
+
+    std::pmr::vector<Value> parts(GetMemoryResource());
+    if (delim.empty()) {
+        CheckMemory(std::get<StringPtr>(args[0])->GetLength() * sizeof(Value));
+        parts.reserve(std::get<StringPtr>(args[0])->GetLength());
+        for (size_t begin = 0; begin < str.size();) {
+            size_t end = begin + 1;
+            while (end < str.size() && (static_cast<unsigned char>(str[end]) & 0xC0) == 0x80) {
+                ++end;
+            }
+            parts.push_back(end == begin + 1 ? MakeCharString(str[begin]) : MakeString(str.substr(begin, end - begin)));
+            begin = end;
+        }
+        return MakeList(std::move(parts));
+    }
+
+    size_t found = FindSubstring(str, delim);
+    if (found == std::string::npos) {
+        parts.push_back(args[0]);
+        return MakeList(std::move(parts));
+    }
+
+    // Long parts share the source's text instead of copying it.
+    const StringPtr& source = std::get<StringPtr>(args[0]);
+    size_t begin = 0;
+    while (found != std::string::npos) {
+        AppendChecked(parts, MakeStringPart(source, str.substr(begin, found - begin)));
+        begin = found + delim.size();
+        found = FindSubstring(str, delim, begin);
+    }
+    AppendChecked(parts, MakeStringPart(source, str.substr(begin)));
+
+    return MakeList(std::move(parts));
+}
+
+// Sizes the result from the string items first so it is allocated once;
+// other values are formatted straight into it.
+static auto builtin_join(Interpreter&, std::span<const Value> args) -> Value {
+    const List& list = expect_list(args, 0, "join");
+    std::string_view delim = expect_string(args, 1, "join");
+
+    size_t size = list.IsEmpty() ? 0 : delim.size() * (list.GetSize() - 1);
+    for (size_t i = 0; i < list.GetSize(); ++i) {
+        if (const auto* str = std::get_if<StringPtr>(&list[i])) {
+            size += (*str)->GetSize();
+        }
+    }
+
+    CheckMemory(size);
+    std::pmr::string result(GetMemoryResource());
+    result.reserve(size);
+    for (size_t i = 0; i < list.GetSize(); ++i) {
+        if (i != 0) {
+            result += delim;
+        }
+        AppendValue(result, list[i]);
+    }
+
+    return MakeString(std::move(result));
+}
+
+static auto builtin_replace(Interpreter&, std::span<const Value> args) -> Value {
+    std::string_view str = expect_string(args, 0, "replace");
+    std::string_view from = expect_string(args, 1, "replace");
+    std::string_view to = expect_string(args, 2, "replace");
+
+    size_t found = from.empty() ? std::string::npos : FindSubstring(str, from);
+    if (found == std::string::npos) {
+        return args[0];
+    }
+
+    std::pmr::string result(GetMemoryResource());
+    result.reserve(str.size());
+    size_t begin = 0;
+    while (found != std::string::npos) {
+        result.append(str, begin, found - begin);
+        result += to;
+        begin = found + from.size();
+        found = FindSubstring(str, from, begin);
+    }
+    result.append(str, begin);
+
+    return MakeString(std::move(result));
+}
+
+// Lists
+
+static auto builtin_range(Interpreter&, std::span<const Value> args) -> Value {
+    double begin = 0;
+    double end = 0;
+    double step = 1;
+    if (args.size() == 1) {
+        end = expect_number(args, 0, "range");
+    } else {
+        begin = expect_number(args, 0, "range");
+        end = expect_number(args, 1, "range");
+    }
+    if (args.size() == 3) {
+        step = expect_number(args, 2, "range");
+    }
+
+    if (step == 0) {
+        throw ScriptError("range() step must not be zero");
+    }
+
+    // Checked up front, as the list is only charged once it is complete.
+    double bytes = std::ceil((end - begin) / step) * static_cast<double>(sizeof(Value));
+    if (bytes > 0) {
+        CheckMemory(bytes < 1e18 ? static_cast<size_t>(bytes) : SIZE_MAX);
+    }
+
+    std::pmr::vector<Value> items(GetMemoryResource());
+    for (double i = begin; (step > 0 ? i < end : i > end); i += step) {
+        items.emplace_back(i);
+    }
+
+    return MakeList(std::move(items));
+}
+
+static auto builtin_push(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    interpreter.CheckSideEffect("push()");
+    List& list = expect_list(args, 0, "push");
+    list.Push(args[1]);
+    return Nil{};
+}
+
+static auto builtin_pop(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    interpreter.CheckSideEffect("pop()");
+    List& list = expect_list(args, 0, "pop");
+    if (list.IsEmpty()) {
+        throw ScriptError("pop() from an empty list");
+    }
+
+    return list.Pop();
+}
+
+static auto builtin_insert(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    interpreter.CheckSideEffect("insert()");
+    List& list = expect_list(args, 0, "insert");
+    size_t position = expect_position(args, 1, list.GetSize(), "insert");
+    list.Insert(position, args[2]);
+    return Nil{};
+}
+
+static auto builtin_remove(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    interpreter.CheckSideEffect("remove()");
+    List& list = expect_list(args, 0, "remove");
+    size_t position = expect_position(args, 1, list.GetSize(), "remove");
+    if (position == list.GetSize()) {
+        throw ScriptError("remove(): index out of range");
+    }
+
+    return list.Remove(position);
+}
+
+static auto builtin_sort(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    interpreter.CheckSideEffect("sort()");
+    List& list = expect_list(args, 0, "sort");
+    list.Sort();
+    return Nil{};
+}
+
+// System
+
+static auto builtin_print(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    interpreter.CheckSideEffect("print()");
+    interpreter.AwaitOutput();
+    interpreter.GetOutputBuffer().Write(args[0]);
+    return Nil{};
+}
+
+static auto builtin_println(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    interpreter.CheckSideEffect("println()");
+    interpreter.AwaitOutput();
+    if (!args.empty()) {
+        interpreter.GetOutputBuffer().Write(args[0]);
+    }
+    interpreter.GetOutputBuffer().Write('\n');
+    return Nil{};
+}
+
+static auto builtin_read(Interpreter& interpreter, std::span<const Value>) -> Value {
+    interpreter.CheckSideEffect("read()");
+    interpreter.AwaitInput();
+    auto line = interpreter.GetInputReader().ReadLine();
+    if (!line) {
+        return Nil{};
+    }
+
+    return MakeString(std::move(*line));
+}
+
+static auto builtin_read_lines(Interpreter& interpreter, std::span<const Value>) -> Value {
+    interpreter.CheckSideEffect("read_lines()");
+    interpreter.AwaitInput(true);
+    std::pmr::vector<Value> lines(GetMemoryResource());
+    while (auto line = interpreter.GetInputReader().ReadLine()) {
+        AppendChecked(lines, MakeString(std::move(*line)));
+    }
+
+    return MakeList(std::move(lines));
+}
+
+static auto builtin_read_all(Interpreter& interpreter, std::span<const Value>) -> Value {
+    interpreter.CheckSideEffect("read_all()");
+    interpreter.AwaitInput(true);
+    return MakeString(interpreter.GetInputReader().ReadAll());
+}
+
+static auto builtin_stacktrace(Interpreter& interpreter, std::span<const Value>) -> Value {
+    interpreter.CheckSideEffect("stacktrace()");
+    std::pmr::vector<Value> frames(GetMemoryResource());
+    for (const auto& frame : interpreter.GetStackTrace()) {
+        frames.push_back(MakeString(frame));
+    }
+
+    return MakeList(std::move(frames));
+}
+
+static const std::array builtins = {
+    BuiltinFunction{"abs", 1, 1, builtin_abs},
+    BuiltinFunction{"ceil", 1, 1, builtin_ceil},
+    BuiltinFunction{"floor", 1, 1, builtin_floor},
+    BuiltinFunction{"round", 1, 1, builtin_round},
+    BuiltinFunction{"sqrt", 1, 1, builtin_sqrt},
+    BuiltinFunction{"rnd", 1, 1, builtin_rnd},
+    BuiltinFunction{"parse_num", 1, 1, builtin_parse_num},
+    BuiltinFunction{"to_string", 1, 1, builtin_to_string},
+
+    BuiltinFunction{"len", 1, 1, builtin_len},
+    BuiltinFunction{"lower", 1, 1, builtin_lower},
+    BuiltinFunction{"upper", 1, 1, builtin_upper},
+    BuiltinFunction{"split", 2, 2, builtin_split},
+    BuiltinFunction{"join", 2, 2, builtin_join},
+    BuiltinFunction{"replace", 3, 3, builtin_replace},
+
+    BuiltinFunction{"range", 1, 3, builtin_range},
+    BuiltinFunction{"push", 2, 2, builtin_push},
+    BuiltinFunction{"pop", 1, 1, builtin_pop},
+    BuiltinFunction{"insert", 3, 3, builtin_insert},
+    BuiltinFunction{"remove", 2, 2, builtin_remove},
+    BuiltinFunction{"sort", 1, 1, builtin_sort},
+    BuiltinFunction{"pmap", 2, 2, BuiltinParallelMap},
+    BuiltinFunction{"pfilter", 2, 2, BuiltinParallelFilter},
+    BuiltinFunction{"preduce", 3, 4, BuiltinParallelReduce},
+
+    BuiltinFunction{"print", 1, 1, builtin_print},
+    BuiltinFunction{"println", 0, 1, builtin_println},
+    BuiltinFunction{"read", 0, 0, builtin_read},
+    BuiltinFunction{"read_lines", 0, 0, builtin_read_lines},
+    BuiltinFunction{"read_all", 0, 0, builtin_read_all},
+    BuiltinFunction{"stacktrace", 0, 0, builtin_stacktrace},
+};
+
+auto GetBuiltins() noexcept -> std::span<const BuiltinFunction> {
+    return builtins;
+}
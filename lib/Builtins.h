@@ -0,0 +1,20 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+
+#include "Value.h"
+
+class Interpreter;
+
+using BuiltinImpl = Value (*)(Interpreter& interpreter, std::span<const Value> args);
+
+struct BuiltinFunction {
+    std::string_view name;
+    size_t min_args;
+    size_t max_args;
+    BuiltinImpl impl;
+};
+
+// Standard library table. Immutable, shared by every interpreter instance.
+auto GetBuiltins() noexcept -> std::span<const BuiltinFunction>;
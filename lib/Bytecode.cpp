@@ -0,0 +1,32 @@
+#include "Bytecode.h"
+
+#include "Compiler.h"
+#include "Lexer.h"
+
+CompiledProgram::CompiledProgram(std::vector<std::unique_ptr<FunctionProto>> functions, SymbolTable symbols)
+    : functions_(std::move(functions))
+    , symbols_(std::move(symbols)) {
+}
+
+auto CompiledProgram::Compile(std::string_view code, std::pmr::memory_resource* resource, WorkStealingPool* pool)
+    -> std::shared_ptr<const CompiledProgram> {
+    // Constants must outlive any script arena the caller may be running in.
+    ScopedMemoryResource heap(std::pmr::get_default_resource());
+
+    Lexer lexer(resource);
+    lexer.SetWorkerPool(pool);
+    lexer.LoadCode(code);
+    lexer.Parse();
+
+    Compiler compiler(lexer.GetTokens(), resource);
+
+    return compiler.Compile();
+}
+
+auto CompiledProgram::GetMain() const noexcept -> const FunctionProto& {
+    return *functions_.front();
+}
+
+auto CompiledProgram::GetSymbols() const noexcept -> const SymbolTable& {
+    return symbols_;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "SymbolTable.h"
+#include "Value.h"
+
+class WorkStealingPool;
+
+enum class OpCode : uint8_t {
+    kConst,
+    kNil,
+    kPop,
+    kDup2,
+
+    // Globals are addressed by SymbolTable id: a for k*Global, b for k*Name.
+    kGetGlobal,
+    kSetGlobal,
+    kGetLocal,
+    kSetLocal,
+    kGetName,
+    kSetName,
+
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kMod,
+    kPow,
+    kEq,
+    kNe,
+    kLt,
+    kGt,
+    kLe,
+    kGe,
+
+    kNeg,
+    kPlus,
+    kNot,
+
+    kJump,
+    kJumpIfFalse,
+    kJumpIfFalseKeep,
+    kJumpIfTrueKeep,
+
+    kCall,
+    kReturn,
+
+    kMakeList,
+    kIndex,
+    kSlice,
+    kSetIndex,
+
+    kIterInit,
+    kIterNext
+};
+
+// kSlice operand flags
+constexpr uint32_t kSliceHasBegin = 1;
+constexpr uint32_t kSliceHasEnd = 2;
+
+struct Instruction {
+    OpCode op;
+    uint32_t a = 0;
+    uint32_t b = 0;
+};
+
+struct FunctionProto {
+    std::string name;
+    size_t arity = 0;
+    size_t local_count = 0;
+
+    std::vector<Instruction> code;
+    // Source position of every instruction, for errors and the profiler.
+    std::vector<size_t> rows;
+    std::vector<size_t> columns;
+    std::vector<Value> constants;
+};
+
+// Result of compiling a script. Immutable once built, so one instance can be
+// executed by any number of Interpreter objects on different threads.
+class CompiledProgram {
+public:
+    CompiledProgram(std::vector<std::unique_ptr<FunctionProto>> functions, SymbolTable symbols);
+
+    // Lexer and compiler scratch state is allocated from `resource`. Large
+    // sources are lexed in parallel on `pool`, see Lexer::SetWorkerPool.
+    static auto Compile(std::string_view code,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+                        WorkStealingPool* pool = nullptr) -> std::shared_ptr<const CompiledProgram>;
+
+    auto GetMain() const noexcept -> const FunctionProto&;
+    auto GetSymbols() const noexcept -> const SymbolTable&;
+
+private:
+    std::vector<std::unique_ptr<FunctionProto>> functions_;
+    SymbolTable symbols_;
+};
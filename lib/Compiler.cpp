@@ -0,0 +1,742 @@
+#include "Compiler.h"
+
+#include <charconv>
+#include <sstream>
+
+static bool is_word_operator(std::string_view text) noexcept {
+    return text == "and" || text == "or" || text == "not";
+}
+
+static bool is_assignment(const Token& token) noexcept {
+    if (token.type != TokenType::kOPERATOR) {
+        return false;
+    }
+
+    return token.text == "=" || token.text == "+=" || token.text == "-=" || token.text == "*=" ||
+           token.text == "/=" || token.text == "%=" || token.text == "^=";
+}
+
+static OpCode compound_operation(std::string_view text) noexcept {
+    switch (text[0]) {
+        case '+':
+            return OpCode::kAdd;
+        case '-':
+            return OpCode::kSub;
+        case '*':
+            return OpCode::kMul;
+        case '/':
+            return OpCode::kDiv;
+        case '%':
+            return OpCode::kMod;
+        default:
+            return OpCode::kPow;
+    }
+}
+
+static auto format_syntax_error(const std::string& message, TokenPos place) -> std::string {
+    std::ostringstream os;
+    os << "syntax error at " << place << ": " << message;
+    return os.str();
+}
+
+SyntaxError::SyntaxError(const std::string& message, TokenPos place)
+    : std::runtime_error(format_syntax_error(message, place))
+    , message_(message)
+    , place_(place) {
+}
+
+auto SyntaxError::GetMessage() const noexcept -> const std::string& {
+    return message_;
+}
+
+auto SyntaxError::GetPlace() const noexcept -> TokenPos {
+    return place_;
+}
+
+Compiler::FunctionState::FunctionState(FunctionProto* proto, std::pmr::memory_resource* resource)
+    : proto(proto)
+    , params(resource)
+    , locals(resource)
+    , loops(resource) {
+}
+
+Compiler::Compiler(std::span<const Token> tokens, std::pmr::memory_resource* resource)
+    : tokens_(tokens)
+    , resource_(resource)
+    , symbols_(&own_symbols_)
+    , states_(resource) {
+}
+
+Compiler::Compiler(std::span<const Token> tokens, SymbolTable& symbols, std::pmr::memory_resource* resource)
+    : tokens_(tokens)
+    , resource_(resource)
+    , symbols_(&symbols)
+    , states_(resource) {
+}
+
+auto Compiler::Compile() -> std::unique_ptr<CompiledProgram> {
+    auto main = std::make_unique<FunctionProto>();
+    main->name = "main";
+    states_.emplace_back(main.get(), resource_);
+    functions_.push_back(std::move(main));
+
+    while (Peek() != nullptr) {
+        TopLevelStatement();
+    }
+
+    Emit(OpCode::kNil);
+    Emit(OpCode::kReturn);
+    states_.clear();
+
+    return std::make_unique<CompiledProgram>(std::move(functions_), std::move(*symbols_));
+}
+
+auto Compiler::CompileStatement(size_t pos) -> StatementFragment {
+    StatementFragment fragment;
+    fragment.main.name = "main";
+
+    pos_ = pos;
+    functions_.clear();
+    states_.clear();
+    states_.emplace_back(&fragment.main, resource_);
+    pending_function_name_ = {};
+
+    TopLevelStatement();
+
+    states_.clear();
+    fragment.end = pos_;
+    fragment.functions = std::move(functions_);
+    functions_.clear();
+
+    return fragment;
+}
+
+auto Compiler::Peek() const noexcept -> const Token* {
+    return pos_ < tokens_.size() ? &tokens_[pos_] : nullptr;
+}
+
+auto Compiler::Previous() const noexcept -> const Token& {
+    return tokens_[pos_ - 1];
+}
+
+auto Compiler::Advance() -> const Token& {
+    if (pos_ >= tokens_.size()) {
+        Error("unexpected end of input");
+    }
+
+    return tokens_[pos_++];
+}
+
+bool Compiler::Check(TokenType type, std::string_view text) const noexcept {
+    const Token* token = Peek();
+    return token != nullptr && token->type == type && token->text == text;
+}
+
+bool Compiler::Match(TokenType type, std::string_view text) {
+    if (!Check(type, text)) {
+        return false;
+    }
+
+    ++pos_;
+    return true;
+}
+
+void Compiler::Expect(TokenType type, std::string_view text) {
+    if (!Match(type, text)) {
+        Error("expected '" + std::string(text) + "'");
+    }
+}
+
+bool Compiler::CheckAssignment() const noexcept {
+    return OnSameRow() && is_assignment(*Peek());
+}
+
+// Expressions never wrap to another line, so an operator on a new row starts
+// a new statement unless we are inside brackets.
+bool Compiler::OnSameRow() const noexcept {
+    const Token* token = Peek();
+    if (token == nullptr || pos_ == 0) {
+        return false;
+    }
+
+    return states_.back().nesting > 0 || token->place.row == Previous().place.row;
+}
+
+void Compiler::Error(const std::string& message) const {
+    TokenPos place = {0, 0};
+    if (const Token* token = Peek()) {
+        place = token->place;
+    } else if (pos_ > 0) {
+        place = Previous().place;
+    }
+
+    throw SyntaxError(message, place);
+}
+
+auto Compiler::Current() -> FunctionState& {
+    return states_.back();
+}
+
+auto Compiler::Emit(OpCode op, uint32_t a, uint32_t b) -> size_t {
+    FunctionProto* proto = Current().proto;
+    proto->code.push_back({op, a, b});
+    TokenPos place = pos_ > 0 ? Previous().place : TokenPos{0, 0};
+    proto->rows.push_back(place.row);
+    proto->columns.push_back(place.column);
+
+    return proto->code.size() - 1;
+}
+
+auto Compiler::AddConstant(Value value) -> uint32_t {
+    auto& constants = Current().proto->constants;
+    constants.push_back(std::move(value));
+
+    return static_cast<uint32_t>(constants.size() - 1);
+}
+
+auto Compiler::Symbol(std::string_view name) -> uint32_t {
+    return symbols_->Intern(name);
+}
+
+void Compiler::PatchJump(size_t jump) {
+    Current().proto->code[jump].a = static_cast<uint32_t>(CodeSize());
+}
+
+auto Compiler::CodeSize() -> size_t {
+    return Current().proto->code.size();
+}
+
+// Pre-scans a function body so names assigned anywhere in it resolve to the
+// same local slot, even when read before the assignment (e.g. in loops).
+void Compiler::CollectLocals(size_t from) {
+    int depth = 0;
+    for (size_t i = from; i < tokens_.size(); ++i) {
+        const Token& token = tokens_[i];
+
+        if (token.type == TokenType::kKEYWORD && token.text == "function") {
+            bool closing = i > from && tokens_[i - 1].type == TokenType::kKEYWORD && tokens_[i - 1].text == "end";
+            depth += closing ? -1 : 1;
+            if (depth < 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (depth != 0 || i + 1 >= tokens_.size()) {
+            continue;
+        }
+
+        const Token& next = tokens_[i + 1];
+        if (token.type == TokenType::kIDENTIFIER && !is_word_operator(token.text) &&
+            is_assignment(next) && next.place.row == token.place.row) {
+            DeclareLocal(token.text);
+        } else if (token.type == TokenType::kKEYWORD && token.text == "for" && next.type == TokenType::kIDENTIFIER) {
+            DeclareLocal(next.text);
+        }
+    }
+}
+
+void Compiler::DeclareLocal(std::string_view name) {
+    FunctionState& state = Current();
+    if (state.params.contains(name) || state.locals.contains(name)) {
+        return;
+    }
+
+    state.locals.emplace(name, static_cast<uint32_t>(state.proto->local_count++));
+}
+
+void Compiler::EmitLoad(std::string_view name) {
+    FunctionState& state = Current();
+    if (auto it = state.params.find(name); it != state.params.end()) {
+        Emit(OpCode::kGetLocal, it->second);
+    } else if (auto local = state.locals.find(name); local != state.locals.end()) {
+        Emit(OpCode::kGetName, local->second, Symbol(name));
+    } else {
+        Emit(OpCode::kGetGlobal, Symbol(name));
+    }
+}
+
+void Compiler::EmitStore(std::string_view name) {
+    if (states_.size() == 1) {
+        Emit(OpCode::kSetGlobal, Symbol(name));
+        return;
+    }
+
+    DeclareLocal(name);
+
+    FunctionState& state = Current();
+    if (auto it = state.params.find(name); it != state.params.end()) {
+        Emit(OpCode::kSetLocal, it->second);
+    } else {
+        Emit(OpCode::kSetName, state.locals.at(name), Symbol(name));
+    }
+}
+
+void Compiler::Block() {
+    while (Peek() != nullptr && !Check(TokenType::kKEYWORD, "end") && !Check(TokenType::kKEYWORD, "else")) {
+        Statement();
+    }
+}
+
+void Compiler::TopLevelStatement() {
+    if (Check(TokenType::kKEYWORD, "end") || Check(TokenType::kKEYWORD, "else")) {
+        Error("unexpected '" + Peek()->text + "'");
+    }
+    Statement();
+}
+
+void Compiler::Statement() {
+    const Token& token = *Peek();
+
+    if (token.type == TokenType::kKEYWORD) {
+        if (token.text == "if") {
+            Advance();
+            IfStatement();
+            return;
+        } else if (token.text == "while") {
+            Advance();
+            WhileStatement();
+            return;
+        } else if (token.text == "for") {
+            Advance();
+            ForStatement();
+            return;
+        } else if (token.text == "return") {
+            Advance();
+            ReturnStatement();
+            return;
+        } else if (token.text == "break" || token.text == "continue") {
+            Advance();
+            LoopJump(token.text == "break");
+            return;
+        }
+    }
+
+    ParsePrecedence(Precedence::kAssignment);
+    Emit(OpCode::kPop);
+}
+
+void Compiler::IfStatement() {
+    std::vector<size_t> end_jumps;
+
+    while (true) {
+        Expression();
+        Expect(TokenType::kKEYWORD, "then");
+        size_t skip = Emit(OpCode::kJumpIfFalse);
+        Block();
+
+        if (!Check(TokenType::kKEYWORD, "else")) {
+            PatchJump(skip);
+            break;
+        }
+
+        end_jumps.push_back(Emit(OpCode::kJump));
+        PatchJump(skip);
+        Advance();
+
+        if (Check(TokenType::kKEYWORD, "if") && Peek()->place.row == Previous().place.row) {
+            Advance();
+            continue;
+        }
+
+        Block();
+        break;
+    }
+
+    Expect(TokenType::kKEYWORD, "end");
+    Expect(TokenType::kKEYWORD, "if");
+
+    for (size_t jump : end_jumps) {
+        PatchJump(jump);
+    }
+}
+
+void Compiler::WhileStatement() {
+    size_t start = CodeSize();
+    Expression();
+    size_t exit = Emit(OpCode::kJumpIfFalse);
+
+    Current().loops.push_back({start, {}});
+    Block();
+    Emit(OpCode::kJump, static_cast<uint32_t>(start));
+
+    PatchJump(exit);
+    for (size_t jump : Current().loops.back().break_jumps) {
+        PatchJump(jump);
+    }
+    Current().loops.pop_back();
+
+    Expect(TokenType::kKEYWORD, "end");
+    Expect(TokenType::kKEYWORD, "while");
+}
+
+void Compiler::ForStatement() {
+    if (Peek() == nullptr || Peek()->type != TokenType::kIDENTIFIER) {
+        Error("expected loop variable name");
+    }
+    std::string_view name = Advance().text;
+
+    Expect(TokenType::kKEYWORD, "in");
+    Expression();
+    Emit(OpCode::kIterInit);
+
+    size_t next = Emit(OpCode::kIterNext);
+    EmitStore(name);
+    Emit(OpCode::kPop);
+
+    Current().loops.push_back({next, {}});
+    Block();
+    Emit(OpCode::kJump, static_cast<uint32_t>(next));
+
+    PatchJump(next);
+    for (size_t jump : Current().loops.back().break_jumps) {
+        PatchJump(jump);
+    }
+    Current().loops.pop_back();
+
+    // iterated value and position
+    Emit(OpCode::kPop);
+    Emit(OpCode::kPop);
+
+    Expect(TokenType::kKEYWORD, "end");
+    Expect(TokenType::kKEYWORD, "for");
+}
+
+void Compiler::ReturnStatement() {
+    bool has_value = Peek() != nullptr && Peek()->place.row == Previous().place.row &&
+                     !Check(TokenType::kKEYWORD, "end") && !Check(TokenType::kKEYWORD, "else");
+    if (has_value) {
+        Expression();
+    } else {
+        Emit(OpCode::kNil);
+    }
+
+    Emit(OpCode::kReturn);
+}
+
+void Compiler::LoopJump(bool is_break) {
+    auto& loops = Current().loops;
+    if (loops.empty()) {
+        pos_ -= 1;
+        Error(std::string(is_break ? "'break'" : "'continue'") + " outside of a loop");
+    }
+
+    if (is_break) {
+        loops.back().break_jumps.push_back(Emit(OpCode::kJump));
+    } else {
+        Emit(OpCode::kJump, static_cast<uint32_t>(loops.back().continue_target));
+    }
+}
+
+void Compiler::Expression() {
+    ParsePrecedence(Precedence::kOr);
+}
+
+void Compiler::ParsePrecedence(Precedence precedence) {
+    bool can_assign = precedence <= Precedence::kAssignment;
+    Prefix(can_assign);
+
+    while (OnSameRow() && precedence <= InfixPrecedence()) {
+        Infix(can_assign);
+    }
+
+    if (can_assign && CheckAssignment()) {
+        Error("invalid assignment target");
+    }
+}
+
+void Compiler::Prefix(bool can_assign) {
+    const Token* token = Peek();
+    if (token == nullptr) {
+        Error("expected expression");
+    }
+
+    switch (token->type) {
+        case TokenType::kNUMBER_INT:
+        case TokenType::kNUMBER_FRAC:
+        case TokenType::kNUMBER_EXP_DIGITS:
+            Number();
+            return;
+        case TokenType::kSTRING:
+            Emit(OpCode::kConst, AddConstant(MakeString(Advance().text)));
+            return;
+        case TokenType::kKEYWORD:
+            if (token->text == "true" || token->text == "false") {
+                Emit(OpCode::kConst, AddConstant(Advance().text == "true" ? 1.0 : 0.0));
+                return;
+            } else if (token->text == "nil") {
+                Advance();
+                Emit(OpCode::kNil);
+                return;
+            } else if (token->text == "function") {
+                FunctionLiteral();
+                return;
+            }
+            break;
+        case TokenType::kIDENTIFIER:
+            if (token->text == "not") {
+                Advance();
+                ParsePrecedence(Precedence::kNot);
+                Emit(OpCode::kNot);
+                return;
+            } else if (!is_word_operator(token->text)) {
+                Variable(can_assign);
+                return;
+            }
+            break;
+        case TokenType::kOPERATOR:
+            if (token->text == "-" || token->text == "+") {
+                OpCode op = Advance().text == "-" ? OpCode::kNeg : OpCode::kPlus;
+                ParsePrecedence(Precedence::kUnary);
+                Emit(op);
+                return;
+            }
+            break;
+        case TokenType::kSPEC_SYMBOL:
+            if (token->text == "(") {
+                Advance();
+                ++Current().nesting;
+                Expression();
+                Expect(TokenType::kSPEC_SYMBOL, ")");
+                --Current().nesting;
+                return;
+            } else if (token->text == "[") {
+                Advance();
+                ListLiteral();
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+
+    Error("unexpected '" + token->text + "'");
+}
+
+auto Compiler::InfixPrecedence() const noexcept -> Precedence {
+    const Token* token = Peek();
+    if (token == nullptr) {
+        return Precedence::kNone;
+    }
+
+    const std::string& text = token->text;
+    switch (token->type) {
+        case TokenType::kOPERATOR:
+            if (text == "+" || text == "-") {
+                return Precedence::kTerm;
+            } else if (text == "*" || text == "/" || text == "%") {
+                return Precedence::kFactor;
+            } else if (text == "^") {
+                return Precedence::kPower;
+            } else if (text == "==" || text == "!=" || text == "<" || text == ">" || text == "<=" || text == ">=") {
+                return Precedence::kComparison;
+            }
+            break;
+        case TokenType::kIDENTIFIER:
+            if (text == "and") {
+                return Precedence::kAnd;
+            } else if (text == "or") {
+                return Precedence::kOr;
+            }
+            break;
+        case TokenType::kSPEC_SYMBOL:
+            if (text == "(" || text == "[") {
+                return Precedence::kCall;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return Precedence::kNone;
+}
+
+static auto binary_operation(const std::string& text) noexcept -> OpCode {
+    static const std::unordered_map<std::string, OpCode> operations = {
+        {"+", OpCode::kAdd}, {"-", OpCode::kSub}, {"*", OpCode::kMul},
+        {"/", OpCode::kDiv}, {"%", OpCode::kMod}, {"^", OpCode::kPow},
+        {"==", OpCode::kEq}, {"!=", OpCode::kNe}, {"<", OpCode::kLt},
+        {">", OpCode::kGt}, {"<=", OpCode::kLe}, {">=", OpCode::kGe}
+    };
+
+    return operations.at(text);
+}
+
+void Compiler::Infix(bool can_assign) {
+    Precedence precedence = InfixPrecedence();
+    const Token& token = Advance();
+
+    if (token.text == "(") {
+        Call();
+    } else if (token.text == "[") {
+        Index(can_assign);
+    } else if (token.text == "and" || token.text == "or") {
+        size_t jump = Emit(token.text == "and" ? OpCode::kJumpIfFalseKeep : OpCode::kJumpIfTrueKeep);
+        Emit(OpCode::kPop);
+        ParsePrecedence(static_cast<Precedence>(static_cast<int>(precedence) + 1));
+        PatchJump(jump);
+    } else {
+        OpCode op = binary_operation(token.text);
+        // '^' is right-associative
+        ParsePrecedence(op == OpCode::kPow ? precedence : static_cast<Precedence>(static_cast<int>(precedence) + 1));
+        Emit(op);
+    }
+}
+
+void Compiler::Number() {
+    const Token& token = Advance();
+    // from_chars ignores the locale, unlike stod.
+    const char* end = token.text.data() + token.text.size();
+    double number;
+    auto [ptr, error] = std::from_chars(token.text.data(), end, number);
+    if (error == std::errc::result_out_of_range) {
+        throw SyntaxError("number out of range", token.place);
+    } else if (error != std::errc() || ptr != end) {
+        throw SyntaxError("invalid number", token.place);
+    }
+
+    Emit(OpCode::kConst, AddConstant(number));
+}
+
+void Compiler::Variable(bool can_assign) {
+    std::string_view name = Advance().text;
+
+    if (can_assign && CheckAssignment()) {
+        std::string_view op = Advance().text;
+        if (op == "=") {
+            if (Check(TokenType::kKEYWORD, "function")) {
+                pending_function_name_ = name;
+            }
+            Expression();
+        } else {
+            EmitLoad(name);
+            Expression();
+            Emit(compound_operation(op));
+        }
+        EmitStore(name);
+        return;
+    }
+
+    EmitLoad(name);
+}
+
+void Compiler::ListLiteral() {
+    ++Current().nesting;
+
+    uint32_t count = 0;
+    while (!Check(TokenType::kSPEC_SYMBOL, "]")) {
+        Expression();
+        ++count;
+        if (!Match(TokenType::kSPEC_SYMBOL, ",")) {
+            break;
+        }
+    }
+    Expect(TokenType::kSPEC_SYMBOL, "]");
+
+    --Current().nesting;
+    Emit(OpCode::kMakeList, count);
+}
+
+void Compiler::FunctionLiteral() {
+    Advance();
+
+    auto proto = std::make_unique<FunctionProto>();
+    proto->name = pending_function_name_.empty() ? "<anonymous>" : pending_function_name_;
+    pending_function_name_ = {};
+
+    FunctionState state(proto.get(), resource_);
+    Expect(TokenType::kSPEC_SYMBOL, "(");
+    while (!Check(TokenType::kSPEC_SYMBOL, ")")) {
+        if (Peek() == nullptr || Peek()->type != TokenType::kIDENTIFIER || is_word_operator(Peek()->text)) {
+            Error("expected parameter name");
+        }
+        const std::string& name = Advance().text;
+        if (!state.params.emplace(name, static_cast<uint32_t>(state.params.size())).second) {
+            pos_ -= 1;
+            Error("duplicate parameter '" + name + "'");
+        }
+        if (!Match(TokenType::kSPEC_SYMBOL, ",")) {
+            break;
+        }
+    }
+    Expect(TokenType::kSPEC_SYMBOL, ")");
+
+    proto->arity = state.params.size();
+    proto->local_count = proto->arity;
+
+    FunctionProto* raw = proto.get();
+    functions_.push_back(std::move(proto));
+    states_.push_back(std::move(state));
+
+    CollectLocals(pos_);
+    Block();
+    Expect(TokenType::kKEYWORD, "end");
+    Expect(TokenType::kKEYWORD, "function");
+
+    Emit(OpCode::kNil);
+    Emit(OpCode::kReturn);
+    states_.pop_back();
+
+    Emit(OpCode::kConst, AddConstant(Function{raw}));
+}
+
+void Compiler::Call() {
+    ++Current().nesting;
+
+    uint32_t count = 0;
+    while (!Check(TokenType::kSPEC_SYMBOL, ")")) {
+        Expression();
+        ++count;
+        if (!Match(TokenType::kSPEC_SYMBOL, ",")) {
+            break;
+        }
+    }
+    Expect(TokenType::kSPEC_SYMBOL, ")");
+
+    --Current().nesting;
+    Emit(OpCode::kCall, count);
+}
+
+void Compiler::Index(bool can_assign) {
+    ++Current().nesting;
+
+    bool is_slice = false;
+    uint32_t flags = 0;
+    if (Match(TokenType::kSPEC_SYMBOL, ":")) {
+        is_slice = true;
+    } else {
+        Expression();
+        if (Match(TokenType::kSPEC_SYMBOL, ":")) {
+            is_slice = true;
+            flags |= kSliceHasBegin;
+        }
+    }
+    if (is_slice && !Check(TokenType::kSPEC_SYMBOL, "]")) {
+        Expression();
+        flags |= kSliceHasEnd;
+    }
+    Expect(TokenType::kSPEC_SYMBOL, "]");
+
+    --Current().nesting;
+
+    if (is_slice) {
+        Emit(OpCode::kSlice, flags);
+        return;
+    }
+
+    if (can_assign && CheckAssignment()) {
+        std::string_view op = Advance().text;
+        if (op == "=") {
+            Expression();
+        } else {
+            Emit(OpCode::kDup2);
+            Emit(OpCode::kIndex);
+            Expression();
+            Emit(compound_operation(op));
+        }
+        Emit(OpCode::kSetIndex);
+        return;
+    }
+
+    Emit(OpCode::kIndex);
+}
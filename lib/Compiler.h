@@ -0,0 +1,136 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Bytecode.h"
+#include "SymbolTable.h"
+#include "TokenImpl.h"
+
+class SyntaxError : public std::runtime_error {
+public:
+    SyntaxError(const std::string& message, TokenPos place);
+
+    auto GetMessage() const noexcept -> const std::string&;
+    auto GetPlace() const noexcept -> TokenPos;
+
+private:
+    std::string message_;
+    TokenPos place_;
+};
+
+// A top-level statement compiled on its own: the code it adds to main and
+// the functions it defines. Jump targets and constant indices in `main` are
+// relative to the statement.
+struct StatementFragment {
+    // Token just past the statement.
+    size_t end = 0;
+    FunctionProto main;
+    std::vector<std::unique_ptr<FunctionProto>> functions;
+};
+
+// Single-pass Pratt compiler from the lexer's token stream to bytecode.
+// Scratch state comes from `resource`; the compiled program does not, as it
+// outlives the compiler. Names are views into `tokens`, which must outlive it.
+class Compiler {
+public:
+    explicit Compiler(std::span<const Token> tokens,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    // Interns global names into `symbols`, so separately compiled statements
+    // agree on their ids. Compile() moves the table into the program.
+    Compiler(std::span<const Token> tokens, SymbolTable& symbols,
+             std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    auto Compile() -> std::unique_ptr<CompiledProgram>;
+    // Compiles the top-level statement starting at token `pos`.
+    auto CompileStatement(size_t pos) -> StatementFragment;
+
+private:
+    enum class Precedence {
+        kNone,
+        kAssignment,
+        kOr,
+        kAnd,
+        kNot,
+        kComparison,
+        kTerm,
+        kFactor,
+        kUnary,
+        kPower,
+        kCall
+    };
+
+    struct LoopContext {
+        size_t continue_target;
+        std::vector<size_t> break_jumps;
+    };
+
+    struct FunctionState {
+        FunctionProto* proto;
+        std::pmr::unordered_map<std::string_view, uint32_t> params;
+        std::pmr::unordered_map<std::string_view, uint32_t> locals;
+        std::pmr::vector<LoopContext> loops;
+        size_t nesting = 0;
+
+        FunctionState(FunctionProto* proto, std::pmr::memory_resource* resource);
+    };
+
+    std::span<const Token> tokens_;
+    std::pmr::memory_resource* resource_;
+    size_t pos_ = 0;
+
+    std::vector<std::unique_ptr<FunctionProto>> functions_;
+    SymbolTable own_symbols_;
+    SymbolTable* symbols_;
+    std::pmr::vector<FunctionState> states_;
+    std::string_view pending_function_name_;
+
+    auto Peek() const noexcept -> const Token*;
+    auto Previous() const noexcept -> const Token&;
+    auto Advance() -> const Token&;
+    bool Check(TokenType type, std::string_view text) const noexcept;
+    bool Match(TokenType type, std::string_view text);
+    void Expect(TokenType type, std::string_view text);
+    bool CheckAssignment() const noexcept;
+    bool OnSameRow() const noexcept;
+    [[noreturn]] void Error(const std::string& message) const;
+
+    auto Current() -> FunctionState&;
+    auto Emit(OpCode op, uint32_t a = 0, uint32_t b = 0) -> size_t;
+    auto AddConstant(Value value) -> uint32_t;
+    auto Symbol(std::string_view name) -> uint32_t;
+    void PatchJump(size_t jump);
+    auto CodeSize() -> size_t;
+
+    void CollectLocals(size_t from);
+    void DeclareLocal(std::string_view name);
+    void EmitLoad(std::string_view name);
+    void EmitStore(std::string_view name);
+
+    void Block();
+    void TopLevelStatement();
+    void Statement();
+    void IfStatement();
+    void WhileStatement();
+    void ForStatement();
+    void ReturnStatement();
+    void LoopJump(bool is_break);
+
+    void Expression();
+    void ParsePrecedence(Precedence precedence);
+    void Prefix(bool can_assign);
+    auto InfixPrecedence() const noexcept -> Precedence;
+    void Infix(bool can_assign);
+
+    void Number();
+    void Variable(bool can_assign);
+    void ListLiteral();
+    void FunctionLiteral();
+    void Call();
+    void Index(bool can_assign);
+};
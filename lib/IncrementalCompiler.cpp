@@ -0,0 +1,174 @@
+#include "IncrementalCompiler.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+static bool is_jump(OpCode op) noexcept {
+    return op == OpCode::kJump || op == OpCode::kJumpIfFalse || op == OpCode::kJumpIfFalseKeep ||
+           op == OpCode::kJumpIfTrueKeep || op == OpCode::kIterNext;
+}
+
+IncrementalCompiler::IncrementalCompiler(std::string_view code) {
+    lexer_.LoadCode(code);
+    lexer_.Parse();
+
+    const auto& tokens = lexer_.GetTokens();
+    Compiler compiler(tokens, symbols_);
+    for (size_t pos = 0; pos < tokens.size(); pos = statements_.back().end_token) {
+        statements_.push_back(CompileAt(compiler, pos));
+    }
+    compiled_ = statements_.size();
+}
+
+auto IncrementalCompiler::CompileAt(Compiler& compiler, size_t pos) const -> Statement {
+    const auto& tokens = lexer_.GetTokens();
+    size_t row = tokens[pos].place.row;
+    Statement statement = {pos, pos, row, {}, std::nullopt};
+
+    try {
+        statement.fragment = compiler.CompileStatement(pos);
+        statement.end_token = statement.fragment.end;
+    } catch (const SyntaxError& e) {
+        // Skip the rest of the row the error is on and carry on from there.
+        TokenPos place = e.GetPlace();
+        auto next = std::partition_point(tokens.begin() + static_cast<ptrdiff_t>(pos) + 1, tokens.end(),
+                                         [&place](const Token& token) { return token.place.row <= place.row; });
+        statement.end_token = static_cast<size_t>(next - tokens.begin());
+        statement.error.emplace(e.GetMessage(), TokenPos{place.row - row, place.column});
+        return statement;
+    }
+
+    for (size_t& code_row : statement.fragment.main.rows) {
+        code_row -= row;
+    }
+    for (const auto& function : statement.fragment.functions) {
+        for (size_t& code_row : function->rows) {
+            code_row -= row;
+        }
+    }
+
+    return statement;
+}
+
+void IncrementalCompiler::Edit(size_t first_row, size_t last_row, std::string_view text) {
+    TokenEdit edit = lexer_.Edit(first_row, last_row, text);
+    const auto& tokens = lexer_.GetTokens();
+    size_t edit_end = edit.first + edit.removed;
+
+    // A statement also reads the token after it to see where it ends.
+    auto kept = std::partition_point(statements_.begin(), statements_.end(),
+                                     [&edit](const Statement& statement) { return statement.end_token < edit.first; });
+    auto moved = std::partition_point(kept, statements_.end(),
+                                      [edit_end](const Statement& statement) { return statement.first_token < edit_end; });
+    if (edit.removed != edit.inserted || edit.row_delta != 0) {
+        for (auto it = moved; it != statements_.end(); ++it) {
+            it->first_token = it->first_token - edit.removed + edit.inserted;
+            it->end_token = it->end_token - edit.removed + edit.inserted;
+            it->row = static_cast<size_t>(static_cast<ptrdiff_t>(it->row) + edit.row_delta);
+        }
+    }
+
+    // Recompile until a statement ends where a moved one starts.
+    size_t pos = kept == statements_.begin() ? 0 : std::prev(kept)->end_token;
+    std::vector<Statement> fresh;
+    Compiler compiler(tokens, symbols_);
+    while (pos < tokens.size()) {
+        while (moved != statements_.end() && moved->first_token < pos) {
+            ++moved;
+        }
+        if (moved != statements_.end() && moved->first_token == pos) {
+            break;
+        }
+        fresh.push_back(CompileAt(compiler, pos));
+        pos = fresh.back().end_token;
+    }
+    if (pos >= tokens.size()) {
+        moved = statements_.end();
+    }
+
+    SpliceItems(statements_, static_cast<size_t>(kept - statements_.begin()), static_cast<size_t>(moved - kept), fresh);
+    compiled_ = fresh.size();
+}
+
+auto IncrementalCompiler::GetErrors() const -> std::vector<SyntaxError> {
+    std::vector<SyntaxError> errors;
+    for (const Statement& statement : statements_) {
+        if (statement.error) {
+            TokenPos place = statement.error->GetPlace();
+            errors.emplace_back(statement.error->GetMessage(), TokenPos{place.row + statement.row, place.column});
+        }
+    }
+
+    return errors;
+}
+
+auto IncrementalCompiler::GetProgram() const -> std::shared_ptr<const CompiledProgram> {
+    auto errors = GetErrors();
+    if (!errors.empty()) {
+        throw errors.front();
+    }
+
+    std::vector<std::unique_ptr<FunctionProto>> functions;
+    functions.push_back(std::make_unique<FunctionProto>());
+    FunctionProto& main = *functions.front();
+    main.name = "main";
+
+    std::unordered_map<const FunctionProto*, const FunctionProto*> relinked;
+    for (const Statement& statement : statements_) {
+        const FunctionProto& code = statement.fragment.main;
+        auto code_base = static_cast<uint32_t>(main.code.size());
+        auto constant_base = static_cast<uint32_t>(main.constants.size());
+
+        for (size_t i = 0; i < code.code.size(); ++i) {
+            Instruction instruction = code.code[i];
+            if (is_jump(instruction.op)) {
+                instruction.a += code_base;
+            } else if (instruction.op == OpCode::kConst) {
+                instruction.a += constant_base;
+            }
+            main.code.push_back(instruction);
+            main.rows.push_back(code.rows[i] + statement.row);
+            main.columns.push_back(code.columns[i]);
+        }
+        main.constants.insert(main.constants.end(), code.constants.begin(), code.constants.end());
+
+        for (const auto& function : statement.fragment.functions) {
+            auto copy = std::make_unique<FunctionProto>(*function);
+            for (size_t& row : copy->rows) {
+                row += statement.row;
+            }
+            relinked.emplace(function.get(), copy.get());
+            functions.push_back(std::move(copy));
+        }
+    }
+
+    for (const auto& function : functions) {
+        for (Value& constant : function->constants) {
+            if (auto* callee = std::get_if<Function>(&constant)) {
+                callee->proto = relinked.at(callee->proto);
+            }
+        }
+    }
+
+    const auto& tokens = lexer_.GetTokens();
+    TokenPos last = tokens.empty() ? TokenPos{0, 0} : tokens.back().place;
+    for (OpCode op : {OpCode::kNil, OpCode::kReturn}) {
+        main.code.push_back({op});
+        main.rows.push_back(last.row);
+        main.columns.push_back(last.column);
+    }
+
+    return std::make_shared<CompiledProgram>(std::move(functions), symbols_);
+}
+
+auto IncrementalCompiler::GetLexer() const noexcept -> const Lexer& {
+    return lexer_;
+}
+
+auto IncrementalCompiler::GetStatementCount() const noexcept -> size_t {
+    return statements_.size();
+}
+
+auto IncrementalCompiler::GetCompiledCount() const noexcept -> size_t {
+    return compiled_;
+}
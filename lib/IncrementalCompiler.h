@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Compiler.h"
+#include "Lexer.h"
+#include "SymbolTable.h"
+
+// Keeps a script lexed and compiled across edits, for a REPL or an editor
+// that re-analyzes on every change. An edit re-lexes only the rows it can
+// affect and recompiles only the top-level statements whose tokens, or the
+// token right after them, changed; the others are reused as they are.
+class IncrementalCompiler {
+public:
+    explicit IncrementalCompiler(std::string_view code = {});
+
+    // Replaces rows [first_row, last_row) with `text`, see Lexer::Edit.
+    void Edit(size_t first_row, size_t last_row, std::string_view text);
+
+    // Parsing resumes on the row after an error, so there may be several.
+    auto GetErrors() const -> std::vector<SyntaxError>;
+    // Links the statements into a program. Throws the first syntax error.
+    auto GetProgram() const -> std::shared_ptr<const CompiledProgram>;
+
+    auto GetLexer() const noexcept -> const Lexer&;
+    auto GetStatementCount() const noexcept -> size_t;
+    // Statements compiled by the last edit; the rest were reused.
+    auto GetCompiledCount() const noexcept -> size_t;
+
+private:
+    struct Statement {
+        size_t first_token;
+        size_t end_token;
+        size_t row;
+        // Rows in the fragment and the error are relative to `row`.
+        StatementFragment fragment;
+        std::optional<SyntaxError> error;
+    };
+
+    Lexer lexer_;
+    SymbolTable symbols_;
+    std::vector<Statement> statements_;
+    size_t compiled_ = 0;
+
+    auto CompileAt(Compiler& compiler, size_t pos) const -> Statement;
+};
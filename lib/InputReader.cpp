@@ -0,0 +1,80 @@
+#include "InputReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr size_t kMinChunk = 64 * 1024;
+
+InputReader::InputReader(std::istream& stream, std::pmr::memory_resource* resource)
+    : stream_(stream)
+    , buffer_(resource) {
+}
+
+auto InputReader::ReadLine() -> std::optional<std::pmr::string> {
+    // Bytes after position_ already known not to contain a newline.
+    size_t searched = 0;
+    while (true) {
+        const char* begin = buffer_.data() + position_ + searched;
+        size_t length = buffer_.size() - position_ - searched;
+        if (const auto* newline = static_cast<const char*>(std::memchr(begin, '\n', length))) {
+            size_t end = static_cast<size_t>(newline - buffer_.data());
+            std::pmr::string line(std::string_view(buffer_).substr(position_, end - position_), buffer_.get_allocator());
+            position_ = end + 1;
+            return line;
+        }
+
+        searched = buffer_.size() - position_;
+        if (!Fill()) {
+            break;
+        }
+    }
+
+    if (position_ == buffer_.size()) {
+        return std::nullopt;
+    }
+
+    std::pmr::string line(std::string_view(buffer_).substr(position_), buffer_.get_allocator());
+    position_ = buffer_.size();
+    return line;
+}
+
+auto InputReader::ReadAll() -> std::pmr::string {
+    while (Fill()) {
+    }
+
+    std::pmr::string rest(std::string_view(buffer_).substr(position_), buffer_.get_allocator());
+    position_ = buffer_.size();
+    return rest;
+}
+
+bool InputReader::HasBufferedLine() const noexcept {
+    return std::memchr(buffer_.data() + position_, '\n', buffer_.size() - position_) != nullptr;
+}
+
+// Appends what the stream buffer has ready, blocking only when it is empty.
+// Returns false at the end of the input.
+bool InputReader::Fill() {
+    if (eof_) {
+        return false;
+    }
+
+    std::streambuf* source = stream_.rdbuf();
+    if (source == nullptr || std::streambuf::traits_type::eq_int_type(source->sgetc(), std::streambuf::traits_type::eof())) {
+        eof_ = true;
+        return false;
+    }
+
+    buffer_.erase(0, position_);
+    position_ = 0;
+
+    std::streamsize available = std::max<std::streamsize>(source->in_avail(), 1);
+    size_t size = buffer_.size();
+    if (buffer_.capacity() < size + static_cast<size_t>(available)) {
+        buffer_.reserve(std::max(2 * buffer_.capacity(), size + std::max(kMinChunk, static_cast<size_t>(available))));
+    }
+    buffer_.resize(size + static_cast<size_t>(available));
+    std::streamsize count = source->sgetn(buffer_.data() + size, available);
+    buffer_.resize(size + static_cast<size_t>(count));
+
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <istream>
+#include <memory_resource>
+#include <optional>
+#include <string>
+
+// Line reader behind read(), read_lines() and read_all(). It pulls whatever
+// the stream buffer already holds in one sgetn() and splits lines with
+// memchr, instead of extracting the input character by character. Only the
+// bytes the buffer reports as available are taken, so an interactive stream
+// is never asked to block for more than the line being read.
+class InputReader {
+public:
+    explicit InputReader(std::istream& stream,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Next line without its '\n', or nullopt at the end of the input. Lines
+    // and the buffer behind them are allocated from the reader's resource.
+    auto ReadLine() -> std::optional<std::pmr::string>;
+    // The rest of the input.
+    auto ReadAll() -> std::pmr::string;
+
+    bool HasBufferedLine() const noexcept;
+
+private:
+    std::istream& stream_;
+    std::pmr::string buffer_;
+    size_t position_ = 0;
+    bool eof_ = false;
+
+    bool Fill();
+};
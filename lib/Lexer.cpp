@@ -1,10 +1,16 @@
 #include "Lexer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <exception>
 #include <regex>
+#include <stdexcept>
 #include <unordered_set>
 #include <iostream>
 
+#include "WorkStealingPool.h"
+
 static const std::string operators = "*/%^=<>!";
 
 static const std::unordered_set<std::string> operators_tokens = {
@@ -22,7 +28,7 @@ static const std::unordered_set<std::string> key_words = {
 };
 
 static const std::unordered_set<std::string> spec_symbols = {
-    "(", ")", "[", "]", ",", "//"
+    "(", ")", "[", "]", ",", ":", "//"
 };
 
 static bool is_char(char c) noexcept {
@@ -68,7 +74,7 @@ static Condition get_condition(char c, char c2) noexcept {
         return Condition::kDot;
     } else if (c == '\n') {
         return Condition::kNextRow;
-    } else if (c == '(' || c == ')' || c == ',' || c == '[' || c == ']') {
+    } else if (c == '(' || c == ')' || c == ',' || c == '[' || c == ']' || c == ':') {
         return Condition::kAutoToken;
     }
 
@@ -81,6 +87,7 @@ static State transition_function(State cur_state, Condition cur_condition) noexc
         if (cur_state == State::kSTRING) return State::kSTRING;
 
     } else if (cur_condition == Condition::kDigit) {
+        if (cur_state == State::kIDENTIFIER) return State::kIDENTIFIER;
         if (cur_state == State::kEMPTY || cur_state == State::kNUMBER_INT) return State::kNUMBER_INT;
         if (cur_state == State::kNUMBER_FRAC) return State::kNUMBER_FRAC;
         if (cur_state == State::kNUMBER_EXP || cur_state == State::kNUMBER_EXP_SIGN || cur_state == State::kNUMBER_EXP_DIGITS) return State::kNUMBER_EXP_DIGITS;
@@ -89,6 +96,7 @@ static State transition_function(State cur_state, Condition cur_condition) noexc
         if (cur_state == State::kNUMBER_INT) return State::kNUMBER_FRAC;
 
     } else if (cur_condition == Condition::kEpsilon) {
+        if (cur_state == State::kEMPTY || cur_state == State::kIDENTIFIER) return State::kIDENTIFIER;
         if (cur_state == State::kNUMBER_INT || cur_state == State::kNUMBER_FRAC) return State::kNUMBER_EXP;
 
     } else if (cur_condition == Condition::kSign) {
@@ -126,16 +134,48 @@ static State transition_function(State cur_state, Condition cur_condition) noexc
 void LexerContext::Clear() noexcept {
     token = "";
     current_state_ = State::kEMPTY;
+    start = {0, 0};
     column = 0;
     row = 0;
     index = 0;
 }
 
+bool LexerContext::InString() const noexcept {
+    return current_state_ == State::kSTRING || current_state_ == State::kSTRING_ESCAPE;
+}
+
+
+Lexer::Lexer(std::pmr::memory_resource* resource)
+    : parsing_result_(resource)
+    , lexed_(resource)
+    , code_(resource)
+    , lines_(resource) {
+}
+
+void Lexer::SetWorkerPool(WorkStealingPool* pool, size_t chunk_size) noexcept {
+    pool_ = pool;
+    chunk_size_ = std::max<size_t>(chunk_size, 1);
+}
 
-void Lexer::LoadCode(const std::string &code) {
+void Lexer::LoadCode(std::string_view code) {
     code_ = code;
 }
 
+static char unescape(char symbol) noexcept {
+    switch (symbol) {
+        case 'n':
+            return '\n';
+        case 't':
+            return '\t';
+        case 'r':
+            return '\r';
+        case '0':
+            return '\0';
+        default:
+            return symbol;
+    }
+}
+
 static void processing_redundant_symbol(char symbol, size_t& row, size_t& column) noexcept {
     if (symbol == '\n') {
         ++row;
@@ -145,83 +185,260 @@ static void processing_redundant_symbol(char symbol, size_t& row, size_t& column
     }
 }
 
-void Lexer::AddToken() {
-    size_t token_column = context_.column - context_.token.size();
-    TokenPos token_pos = {context_.row, (context_.current_state_ == State::kSTRING ? token_column - 2 : token_column)};
-    Token token_to_add = {context_.current_state_, context_.token, token_pos};
-    parsing_result_.push_back(token_to_add);
-    context_.token = "";
-    context_.current_state_ = State::kEMPTY;
+void Lexer::AddToken(LexerContext& context, std::pmr::vector<Token>& tokens) {
+    Token token_to_add = {context.current_state_, context.token, context.start};
+    tokens.push_back(token_to_add);
+    context.token = "";
+    context.current_state_ = State::kEMPTY;
 }
 
-void Lexer::EmptyStateProcessing() {
-    if (key_words.contains(context_.token)) {
-        context_.current_state_ = State::kKEYWORD;
+void Lexer::EmptyStateProcessing(LexerContext& context, std::pmr::vector<Token>& tokens) const {
+    if (key_words.contains(context.token)) {
+        context.current_state_ = State::kKEYWORD;
     }
 
-    if (context_.current_state_ == State::kEMPTY) {
-        processing_redundant_symbol(code_[context_.index], context_.row, context_.column);
-        ++context_.index;
+    if (context.current_state_ == State::kEMPTY) {
+        processing_redundant_symbol(code_[context.index], context.row, context.column);
+        ++context.index;
         return;
     }
 
-    if (context_.current_state_ == State::kEND_STRING) {
-        context_.current_state_ = State::kSTRING;
-        context_.token = context_.token.substr(1, context_.token.size() - 2);
+    if (context.current_state_ == State::kEND_STRING) {
+        context.current_state_ = State::kSTRING;
+        context.token = context.token.substr(1, context.token.size() - 2);
     }
 
-    AddToken();
+    AddToken(context, tokens);
 }
 
-void Lexer::CommentStateProcessing() noexcept {
-    context_.current_state_ = State::kEMPTY;
-    while (context_.index < code_.size()) {
-        if (code_[context_.index] == '\n') {
+void Lexer::CommentStateProcessing(LexerContext& context) const noexcept {
+    context.current_state_ = State::kEMPTY;
+    while (context.index < code_.size()) {
+        if (code_[context.index] == '\n') {
             break;
         };
-        ++context_.index;
+        ++context.index;
     }
-    ++context_.row;
-    context_.column = 0;
-    context_.token = "";
+    ++context.row;
+    context.column = 0;
+    context.token = "";
 }
 
-State Lexer::Transition() const noexcept {
-    char symbol = (context_.index == code_.size() ? '\n' : code_[context_.index]);
-    char next_symbol = (context_.index + 1 < code_.size() ? code_[context_.index + 1] : '\t');
+State Lexer::Transition(const LexerContext& context) const noexcept {
+    char symbol = (context.index == code_.size() ? '\n' : code_[context.index]);
+    char next_symbol = (context.index + 1 < code_.size() ? code_[context.index + 1] : '\t');
 
-    auto state = transition_function(context_.current_state_, get_condition(symbol, next_symbol));
+    auto state = transition_function(context.current_state_, get_condition(symbol, next_symbol));
 
     return state;
 }
 
-void Lexer::StateProcessing(State new_state) {
+void Lexer::StateProcessing(LexerContext& context, State new_state, std::pmr::vector<Token>& tokens) const {
     if (new_state == State::kEMPTY) {
-        EmptyStateProcessing();
+        EmptyStateProcessing(context, tokens);
         return;
     }
 
-    context_.current_state_ = new_state;
-    if (context_.current_state_ != State::kSTRING_ESCAPE) {
-        context_.token += code_[context_.index];
-        ++context_.column;
+    char symbol = code_[context.index];
+    bool escaped = context.current_state_ == State::kSTRING_ESCAPE;
+    context.current_state_ = new_state;
+    if (context.current_state_ != State::kSTRING_ESCAPE) {
+        if (context.token.empty()) {
+            context.start = {context.row, context.column};
+        }
+        context.token += (escaped ? unescape(symbol) : symbol);
     }
+    // Strings may span lines; rows stay in step with the source.
+    processing_redundant_symbol(symbol, context.row, context.column);
 
-    if (context_.current_state_ == State::kCOMMENT) {
-        CommentStateProcessing();
+    if (context.current_state_ == State::kCOMMENT) {
+        CommentStateProcessing(context);
     }
 
-    ++context_.index;
+    ++context.index;
+}
+
+void Lexer::LexRange(LexerContext& context, size_t limit, std::pmr::vector<Token>& tokens) {
+    while (context.index < limit) {
+        size_t row = context.row;
+        StateProcessing(context, Transition(context), tokens);
+        if (context.row != row && context.index <= code_.size()) {
+            lines_[context.row].in_string = context.InString();
+        }
+    }
 }
 
 void Lexer::Parse() {
+    lines_.assign(1, {0, false});
+    for (size_t i = code_.find('\n'); i != std::string::npos; i = code_.find('\n', i + 1)) {
+        lines_.push_back({i + 1, false});
+    }
+
+    lexed_.clear();
+    size_t max_chunks = pool_ != nullptr ? pool_->GetThreadCount() * 4 : 1;
+    size_t chunks = std::min(code_.size() / chunk_size_, max_chunks);
+    if (chunks > 1) {
+        ParseChunks(chunks);
+    } else {
+        LexRange(context_, code_.size() + 1, lexed_);
+    }
+
+    parsing_result_.swap(lexed_);
+    lexed_.clear();
+    context_.Clear();
+}
+
+void Lexer::ParseChunks(size_t count) {
+    // Chunks start at line starts, where lexing begins afresh unless a
+    // string literal runs across the line break.
+    struct Chunk {
+        LexerContext context;
+        size_t limit = 0;
+        // Workers do not share the lexer's resource, which need not be
+        // thread-safe.
+        std::pmr::vector<Token> tokens{std::pmr::new_delete_resource()};
+        std::exception_ptr error;
+    };
+
+    std::vector<Chunk> chunks;
+    for (size_t i = 0; i < count; ++i) {
+        size_t target = code_.size() / count * i;
+        auto line = std::lower_bound(lines_.begin(), lines_.end(), target,
+                                     [](const Line& line, size_t offset) { return line.offset < offset; });
+        auto row = static_cast<size_t>(line - lines_.begin());
+        if (chunks.empty() || row > chunks.back().context.row) {
+            chunks.emplace_back().context.row = row;
+            chunks.back().context.index = line->offset;
+        }
+    }
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].limit = i + 1 < chunks.size() ? chunks[i + 1].context.index : code_.size() + 1;
+    }
+
+    // Every chunk but the first guesses that it starts outside a string.
+    // They only write the rows they enter, so they can share lines_.
+    std::atomic<size_t> remaining = chunks.size();
+    for (Chunk& chunk : chunks) {
+        pool_->Submit([this, &chunk, &remaining] {
+            try {
+                LexRange(chunk.context, chunk.limit, chunk.tokens);
+            } catch (...) {
+                chunk.error = std::current_exception();
+            }
+            remaining.fetch_sub(1);
+        });
+    }
+    pool_->WaitFor(remaining);
+    for (const Chunk& chunk : chunks) {
+        if (chunk.error) {
+            std::rethrow_exception(chunk.error);
+        }
+    }
+
+    size_t total = 0;
+    for (const Chunk& chunk : chunks) {
+        total += chunk.tokens.size();
+    }
+    lexed_.reserve(total);
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        Chunk& chunk = chunks[i];
+        if (i > 0 && chunks[i - 1].context.InString()) {
+            // The guess was wrong: finish the string the previous chunk left
+            // open and lex the rest of this chunk after it.
+            chunk.context = std::move(chunks[i - 1].context);
+            chunk.tokens.clear();
+            LexRange(chunk.context, chunk.limit, chunk.tokens);
+        }
+        lexed_.insert(lexed_.end(), std::make_move_iterator(chunk.tokens.begin()),
+                      std::make_move_iterator(chunk.tokens.end()));
+    }
+}
+
+auto Lexer::Edit(size_t first_row, size_t last_row, std::string_view text) -> TokenEdit {
+    if (lines_.empty()) {
+        Parse();
+    }
+    if (first_row > last_row || last_row > lines_.size()) {
+        throw std::out_of_range("Lexer::Edit: rows out of range");
+    }
+
+    auto offset = [this](size_t row) { return row < lines_.size() ? lines_[row].offset : code_.size(); };
+    size_t begin = offset(first_row);
+    size_t end = offset(last_row);
+    code_.replace(begin, end - begin, text);
+    size_t text_end = begin + text.size();
+
+    size_t lex_row = std::min(first_row, lines_.size() - 1);
+    while (lex_row > 0 && lines_[lex_row].in_string) {
+        --lex_row;
+    }
+
+    // Past the new text the code is the old one shifted, so lexing stops at
+    // the first row that starts outside a string now and did so before.
+    std::pmr::vector<Line> fresh(lines_.get_allocator());
+    size_t stop = lines_.size();
+
+    context_.Clear();
+    context_.row = lex_row;
+    context_.index = lines_[lex_row].offset;
     while (context_.index <= code_.size()) {
+        size_t row = context_.row;
+        StateProcessing(context_, Transition(context_), lexed_);
+        if (context_.row == row || context_.index > code_.size()) {
+            continue;
+        }
+
+        size_t start = context_.index;
+        if (start >= text_end && !context_.InString()) {
+            size_t old_start = start - text_end + end;
+            auto old = std::lower_bound(lines_.begin() + static_cast<ptrdiff_t>(lex_row), lines_.end(), old_start,
+                                        [](const Line& line, size_t value) { return line.offset < value; });
+            if (old != lines_.end() && old->offset == old_start && !old->in_string) {
+                stop = static_cast<size_t>(old - lines_.begin());
+                break;
+            }
+        }
+        fresh.push_back({start, context_.InString()});
+    }
+    size_t new_stop = lex_row + 1 + fresh.size();
+
+    auto before_row = [](const Token& token, size_t row) { return token.place.row < row; };
+    auto first = std::lower_bound(parsing_result_.begin(), parsing_result_.end(), lex_row, before_row);
+    auto last = std::lower_bound(first, parsing_result_.end(), stop, before_row);
 
-        auto state = Transition();
-        StateProcessing(state);
+    TokenEdit edit = {static_cast<size_t>(first - parsing_result_.begin()), static_cast<size_t>(last - first),
+                      lexed_.size(), static_cast<ptrdiff_t>(new_stop) - static_cast<ptrdiff_t>(stop)};
+
+    SpliceItems(parsing_result_, edit.first, edit.removed, lexed_);
+    if (edit.row_delta != 0) {
+        for (size_t i = edit.first + edit.inserted; i < parsing_result_.size(); ++i) {
+            parsing_result_[i].place.row = parsing_result_[i].place.row - stop + new_stop;
+        }
     }
 
+    if (stop == lex_row) {
+        // Rows were only inserted before lex_row, which moves down whole.
+        fresh.insert(fresh.begin(), lines_[lex_row]);
+    }
+    size_t from = std::min(stop, lex_row + 1);
+    SpliceItems(lines_, from, stop - from, fresh);
+    for (size_t i = new_stop; i < lines_.size(); ++i) {
+        lines_[i].offset = lines_[i].offset - end + text_end;
+    }
+
+    lexed_.clear();
     context_.Clear();
+
+    return edit;
+}
+
+auto Lexer::GetCode() const noexcept -> std::string_view {
+    return code_;
+}
+
+auto Lexer::GetRowCount() const noexcept -> size_t {
+    return lines_.size();
 }
 
 static std::string token_type_to_str(TokenType token_type) noexcept {
@@ -264,5 +481,9 @@ void Lexer::PrintAllTokens() const noexcept {
 }
 
 auto Lexer::GetParsingResult() const -> std::vector<Token> {
+    return {parsing_result_.begin(), parsing_result_.end()};
+}
+
+auto Lexer::GetTokens() const noexcept -> const std::pmr::vector<Token>& {
     return parsing_result_;
 }
\ No newline at end of file
@@ -1,41 +1,111 @@
 #pragma once
 
+#include <algorithm>
+#include <iterator>
+#include <memory_resource>
+#include <string_view>
 #include <vector>
 
 #include "TokenImpl.h"
 
+class WorkStealingPool;
+
 using State = TokenType;
 
 struct LexerContext {
     std::string token;
     State current_state_ = State::kEMPTY;
+    TokenPos start = {0, 0};
     size_t column = 0;
     size_t row = 0;
     size_t index = 0;
 
     void Clear() noexcept;
+    bool InString() const noexcept;
+};
+
+// Tokens [first, first + removed) were replaced by [first, first + inserted);
+// the rows of the tokens after them moved by row_delta.
+struct TokenEdit {
+    size_t first = 0;
+    size_t removed = 0;
+    size_t inserted = 0;
+    ptrdiff_t row_delta = 0;
 };
 
+// Replaces items [first, first + removed) with `inserted`, moving the tail
+// at most once, so an edit that keeps the count moves nothing.
+template <typename Items, typename Inserted>
+void SpliceItems(Items& items, size_t first, size_t removed, Inserted& inserted) {
+    size_t common = std::min(removed, inserted.size());
+    auto at = items.begin() + static_cast<ptrdiff_t>(first);
+    std::move(inserted.begin(), inserted.begin() + static_cast<ptrdiff_t>(common), at);
+    at += static_cast<ptrdiff_t>(common);
+
+    if (inserted.size() > removed) {
+        items.insert(at, std::make_move_iterator(inserted.begin() + static_cast<ptrdiff_t>(common)),
+                     std::make_move_iterator(inserted.end()));
+    } else {
+        items.erase(at, at + static_cast<ptrdiff_t>(removed - common));
+    }
+}
+
+// Tokens and the code copy are allocated from `resource`.
 class Lexer {
 public:
+    static constexpr size_t kDefaultChunkSize = 256 * 1024;
+
+    explicit Lexer(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
     void Parse();
 
+    // With a pool, Parse() cuts code of two chunks or more at line starts
+    // and lexes the chunks in parallel; tokens never span lines except for
+    // string literals, which are fixed up when the chunks are merged.
+    void SetWorkerPool(WorkStealingPool* pool, size_t chunk_size = kDefaultChunkSize) noexcept;
+
     void PrintAllTokens() const noexcept;
 
     auto GetParsingResult() const -> std::vector<Token>;
+    auto GetTokens() const noexcept -> const std::pmr::vector<Token>&;
+
+    void LoadCode(std::string_view code);
 
-    void LoadCode(const std::string& code);
+    // Replaces rows [first_row, last_row) of the parsed code with `text` and
+    // re-lexes only the lines that can change: from the edit up to the first
+    // line that starts outside a string literal both before and after it.
+    auto Edit(size_t first_row, size_t last_row, std::string_view text) -> TokenEdit;
+
+    auto GetCode() const noexcept -> std::string_view;
+    auto GetRowCount() const noexcept -> size_t;
 
 private:
-    std::vector<Token> parsing_result_;
-    std::string code_;
+    std::pmr::vector<Token> parsing_result_;
+    std::pmr::vector<Token> lexed_;
+    std::pmr::string code_;
+
+    struct Line {
+        size_t offset;
+        // The row starts inside a string literal, so lexing cannot restart there.
+        bool in_string;
+    };
+    std::pmr::vector<Line> lines_;
 
     LexerContext context_;
+    WorkStealingPool* pool_ = nullptr;
+    size_t chunk_size_ = kDefaultChunkSize;
+
+    // The state machine steps on an explicit context and token buffer, so
+    // that chunks can be lexed side by side.
+    void EmptyStateProcessing(LexerContext& context, std::pmr::vector<Token>& tokens) const;
+    void CommentStateProcessing(LexerContext& context) const noexcept;
 
-    void EmptyStateProcessing();
-    void CommentStateProcessing() noexcept;
+    State Transition(const LexerContext& context) const noexcept;
+    void StateProcessing(LexerContext& context, State new_state, std::pmr::vector<Token>& tokens) const;
+    static void AddToken(LexerContext& context, std::pmr::vector<Token>& tokens);
 
-    State Transition() const noexcept;
-    void StateProcessing(State new_state);
-    void AddToken();
+    // Lexes until the code offset `limit` (code size + 1 for the end of the
+    // code) and marks the rows it enters that start inside a string.
+    void LexRange(LexerContext& context, size_t limit, std::pmr::vector<Token>& tokens);
+    void ParseChunks(size_t count);
 };
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "Operators.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+static auto op_to_str(OpCode op) noexcept -> std::string_view {
+    switch (op) {
+        case OpCode::kAdd:
+            return "+";
+        case OpCode::kSub:
+            return "-";
+        case OpCode::kMul:
+            return "*";
+        case OpCode::kDiv:
+            return "/";
+        case OpCode::kMod:
+            return "%";
+        case OpCode::kPow:
+            return "^";
+        case OpCode::kEq:
+            return "==";
+        case OpCode::kNe:
+            return "!=";
+        case OpCode::kLt:
+            return "<";
+        case OpCode::kGt:
+            return ">";
+        case OpCode::kLe:
+            return "<=";
+        case OpCode::kGe:
+            return ">=";
+        case OpCode::kNeg:
+        case OpCode::kPlus:
+            return "unary";
+        case OpCode::kNot:
+            return "not";
+        default:
+            return "?";
+    }
+}
+
+[[noreturn]] static void unsupported(OpCode op, const Value& lhs, const Value& rhs) {
+    throw ScriptError("operator " + std::string(op_to_str(op)) + " is not defined for " +
+                      std::string(TypeName(lhs)) + " and " + std::string(TypeName(rhs)));
+}
+
+static double boolean(bool value) noexcept {
+    return value ? 1 : 0;
+}
+
+// Binary operators are a matrix over (operator, left type, right type). Each
+// defined cell is an `apply` overload below, picked by the operator tag and
+// the two operand types; the table at the end is generated from whichever
+// overloads exist, so a pair with no overload lands in `unsupported`.
+template <OpCode Op>
+using OpTag = std::integral_constant<OpCode, Op>;
+
+template <OpCode Op>
+concept Arithmetic = Op >= OpCode::kAdd && Op <= OpCode::kPow;
+
+template <OpCode Op>
+concept Equality = Op == OpCode::kEq || Op == OpCode::kNe;
+
+template <OpCode Op>
+concept Ordering = Op >= OpCode::kLt && Op <= OpCode::kGe;
+
+template <OpCode Op, typename T>
+static bool compare(const T& a, const T& b) {
+    if constexpr (Op == OpCode::kLt) {
+        return a < b;
+    } else if constexpr (Op == OpCode::kGt) {
+        return a > b;
+    } else if constexpr (Op == OpCode::kLe) {
+        return a <= b;
+    } else {
+        return a >= b;
+    }
+}
+
+static bool same_type_equal(const Nil&, const Nil&) noexcept {
+    return true;
+}
+
+static bool same_type_equal(double a, double b) noexcept {
+    return a == b;
+}
+
+static bool same_type_equal(const StringPtr& a, const StringPtr& b) noexcept {
+    return a == b || *a == *b;
+}
+
+static bool same_type_equal(const ListPtr& a, const ListPtr& b) {
+    return a == b || ListsEqual(*a, *b);
+}
+
+static bool same_type_equal(const Function& a, const Function& b) noexcept {
+    return a.proto == b.proto;
+}
+
+static bool same_type_equal(const Builtin& a, const Builtin& b) noexcept {
+    return a.function == b.function;
+}
+
+static bool same_type_equal(const Unset&, const Unset&) noexcept {
+    return false;
+}
+
+// == and != are defined on every pair; values of different types differ.
+template <OpCode Op, typename L, typename R>
+    requires Equality<Op>
+static auto apply(OpTag<Op>, const L& a, const R& b) -> Value {
+    bool equal = false;
+    if constexpr (std::is_same_v<L, R>) {
+        equal = same_type_equal(a, b);
+    }
+    return boolean(equal == (Op == OpCode::kEq));
+}
+
+template <OpCode Op>
+    requires Arithmetic<Op>
+static auto apply(OpTag<Op>, double a, double b) -> Value {
+    if constexpr (Op == OpCode::kAdd) {
+        return a + b;
+    } else if constexpr (Op == OpCode::kSub) {
+        return a - b;
+    } else if constexpr (Op == OpCode::kMul) {
+        return a * b;
+    } else if constexpr (Op == OpCode::kDiv) {
+        if (b == 0) {
+            throw ScriptError("division by zero");
+        }
+        return a / b;
+    } else if constexpr (Op == OpCode::kMod) {
+        if (b == 0) {
+            throw ScriptError("division by zero");
+        }
+        double result = std::fmod(a, b);
+        if (result != 0 && ((result < 0) != (b < 0))) {
+            result += b;
+        }
+        return result;
+    } else {
+        return std::pow(a, b);
+    }
+}
+
+template <OpCode Op>
+    requires Ordering<Op>
+static auto apply(OpTag<Op>, double a, double b) -> Value {
+    return boolean(compare<Op>(a, b));
+}
+
+template <OpCode Op>
+    requires Ordering<Op>
+static auto apply(OpTag<Op>, const StringPtr& a, const StringPtr& b) -> Value {
+    return boolean(compare<Op>(a->GetText(), b->GetText()));
+}
+
+static auto apply(OpTag<OpCode::kAdd>, const StringPtr& a, const StringPtr& b) -> Value {
+    CheckMemory(a->GetSize() + b->GetSize());
+    std::pmr::string result(GetMemoryResource());
+    result.reserve(a->GetSize() + b->GetSize());
+    result += a->GetText();
+    result += b->GetText();
+    return MakeString(std::move(result));
+}
+
+// Removes `b` from the end of `a` if it is there.
+static auto apply(OpTag<OpCode::kSub>, const StringPtr& a, const StringPtr& b) -> Value {
+    std::string_view text = a->GetText();
+    if (b->IsEmpty() || !text.ends_with(b->GetText())) {
+        return a;
+    }
+    return MakeString(text.substr(0, text.size() - b->GetSize()));
+}
+
+// Repeating is capped well below what size_t or the allocator could take.
+static constexpr double kMaxRepeatSize = 4294967296.0;
+
+struct RepeatCount {
+    size_t whole;
+    double fraction;
+};
+
+// Splits `count` repetitions of `size` items into whole copies and a
+// fraction of one, after checking that the result stays within the cap, so
+// neither the casts nor size * whole can overflow.
+static auto check_repeat_count(double count, size_t size) -> RepeatCount {
+    if (count < 0 || !std::isfinite(count)) {
+        throw ScriptError("invalid repeat count");
+    }
+    if (count * static_cast<double>(std::max<size_t>(size, 1)) > kMaxRepeatSize) {
+        throw ScriptError("repeat count too large");
+    }
+
+    auto whole = static_cast<size_t>(count);
+    return {whole, count - static_cast<double>(whole)};
+}
+
+static auto apply(OpTag<OpCode::kMul>, const StringPtr& source, double count) -> Value {
+    auto [whole, fraction] = check_repeat_count(count, source->GetSize());
+    if (source->IsEmpty()) {
+        return source;
+    }
+    std::string_view str = source->GetText();
+    auto tail = source->GetOffset(static_cast<size_t>(fraction * static_cast<double>(source->GetLength())));
+
+    CheckMemory(str.size() * whole + tail);
+    std::pmr::string result(GetMemoryResource());
+    result.reserve(str.size() * whole + tail);
+    for (size_t i = 0; i < whole; ++i) {
+        result += str;
+    }
+    result.append(str, 0, tail);
+
+    return MakeString(std::move(result));
+}
+
+static auto apply(OpTag<OpCode::kMul> op, double count, const StringPtr& source) -> Value {
+    return apply(op, source, count);
+}
+
+static auto apply(OpTag<OpCode::kAdd>, const ListPtr& a, const ListPtr& b) -> Value {
+    CheckMemory((a->GetSize() + b->GetSize()) * sizeof(Value));
+    std::pmr::vector<Value> result(GetMemoryResource());
+    result.reserve(a->GetSize() + b->GetSize());
+    for (const ListPtr& list : {a, b}) {
+        for (size_t i = 0; i < list->GetSize(); ++i) {
+            result.push_back((*list)[i]);
+        }
+    }
+    return MakeList(std::move(result));
+}
+
+// The result shares the list's items and is only copied out when written.
+static auto apply(OpTag<OpCode::kMul>, const ListPtr& list, double count) -> Value {
+    auto [whole, fraction] = check_repeat_count(count, list->GetSize());
+    auto tail = static_cast<size_t>(fraction * static_cast<double>(list->GetSize()));
+    return list->Repeat(list->GetSize() * whole + tail);
+}
+
+static auto apply(OpTag<OpCode::kMul> op, double count, const ListPtr& list) -> Value {
+    return apply(op, list, count);
+}
+
+template <OpCode Op, typename L, typename R>
+concept Defined = requires(const L& lhs, const R& rhs) {
+    { apply(OpTag<Op>{}, lhs, rhs) } -> std::same_as<Value>;
+};
+
+using BinaryHandler = auto (*)(const Value&, const Value&) -> Value;
+
+static constexpr size_t kTypeCount = std::variant_size_v<Value>;
+static constexpr size_t kFirstBinary = static_cast<size_t>(OpCode::kAdd);
+static constexpr size_t kBinaryCount = static_cast<size_t>(OpCode::kGe) - kFirstBinary + 1;
+
+// One table cell: unwraps both operands to the alternatives it was generated
+// for, so the handler runs without another type check.
+template <size_t Cell>
+static auto dispatch(const Value& lhs, const Value& rhs) -> Value {
+    constexpr auto kOp = static_cast<OpCode>(kFirstBinary + Cell / (kTypeCount * kTypeCount));
+    constexpr size_t kLhs = Cell / kTypeCount % kTypeCount;
+    constexpr size_t kRhs = Cell % kTypeCount;
+    using Lhs = std::variant_alternative_t<kLhs, Value>;
+    using Rhs = std::variant_alternative_t<kRhs, Value>;
+
+    if constexpr (Defined<kOp, Lhs, Rhs>) {
+        return apply(OpTag<kOp>{}, *std::get_if<kLhs>(&lhs), *std::get_if<kRhs>(&rhs));
+    } else {
+        unsupported(kOp, lhs, rhs);
+    }
+}
+
+template <size_t... Cells>
+static constexpr auto make_binary_table(std::index_sequence<Cells...>) {
+    return std::array<BinaryHandler, sizeof...(Cells)>{&dispatch<Cells>...};
+}
+
+static constexpr auto kBinaryTable =
+    make_binary_table(std::make_index_sequence<kBinaryCount * kTypeCount * kTypeCount>{});
+
+auto BinaryOperation(OpCode op, const Value& lhs, const Value& rhs) -> Value {
+    size_t row = static_cast<size_t>(op) - kFirstBinary;
+    return kBinaryTable[(row * kTypeCount + lhs.index()) * kTypeCount + rhs.index()](lhs, rhs);
+}
+
+auto UnaryOperation(OpCode op, const Value& operand) -> Value {
+    if (op == OpCode::kNot) {
+        return boolean(!IsTruthy(operand));
+    }
+
+    const auto* number = std::get_if<double>(&operand);
+    if (number == nullptr) {
+        throw ScriptError("unary " + std::string(op == OpCode::kNeg ? "-" : "+") +
+                          " is not defined for " + std::string(TypeName(operand)));
+    }
+
+    return op == OpCode::kNeg ? -*number : *number;
+}
+
+// Every index past an end of `size` items acts the same, so it is clamped to
+// one past that end first: casting inf or anything past long long is UB.
+static auto to_index(const Value& index, size_t size) -> long long {
+    const auto* number = std::get_if<double>(&index);
+    if (number == nullptr) {
+        throw ScriptError("index must be a number, got " + std::string(TypeName(index)));
+    }
+    if (std::floor(*number) != *number) {
+        throw ScriptError("index must be an integer");
+    }
+
+    double limit = static_cast<double>(size) + 1;
+    return static_cast<long long>(std::clamp(*number, -limit, limit));
+}
+
+static auto normalize_index(const Value& index, size_t size) -> size_t {
+    long long position = to_index(index, size);
+    if (position < 0) {
+        position += static_cast<long long>(size);
+    }
+    if (position < 0 || position >= static_cast<long long>(size)) {
+        throw ScriptError("index out of range");
+    }
+
+    return static_cast<size_t>(position);
+}
+
+auto IndexValue(const Value& container, const Value& index) -> Value {
+    if (const auto* str = std::get_if<StringPtr>(&container)) {
+        return (*str)->CharAt(normalize_index(index, (*str)->GetLength()));
+    }
+    if (const auto* list = std::get_if<ListPtr>(&container)) {
+        return (**list)[normalize_index(index, (*list)->GetSize())];
+    }
+
+    throw ScriptError("cannot index a " + std::string(TypeName(container)));
+}
+
+static auto slice_bound(const Value* bound, size_t size, size_t fallback) -> size_t {
+    if (bound == nullptr) {
+        return fallback;
+    }
+
+    long long position = to_index(*bound, size);
+    auto length = static_cast<long long>(size);
+    if (position < 0) {
+        position += length;
+    }
+
+    return static_cast<size_t>(std::clamp(position, 0LL, length));
+}
+
+auto SliceValue(const Value& container, const Value* begin, const Value* end) -> Value {
+    if (const auto* str = std::get_if<StringPtr>(&container)) {
+        size_t size = (*str)->GetLength();
+        size_t from = slice_bound(begin, size, 0);
+        size_t to = slice_bound(end, size, size);
+        if (from == 0 && to == size) {
+            return container;
+        }
+        return MakeString((*str)->Substr(from, to));
+    }
+    if (const auto* list = std::get_if<ListPtr>(&container)) {
+        size_t size = (*list)->GetSize();
+        return (*list)->Slice(slice_bound(begin, size, 0), slice_bound(end, size, size));
+    }
+
+    throw ScriptError("cannot slice a " + std::string(TypeName(container)));
+}
+
+void SetIndexValue(const Value& container, const Value& index, Value value) {
+    const auto* list = std::get_if<ListPtr>(&container);
+    if (list == nullptr) {
+        throw ScriptError("cannot assign by index to a " + std::string(TypeName(container)));
+    }
+
+    (*list)->Set(normalize_index(index, (*list)->GetSize()), std::move(value));
+}
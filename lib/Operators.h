@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Bytecode.h"
+#include "Value.h"
+
+// Evaluates a binary operator opcode (kAdd .. kGe). Throws ScriptError for
+// operand types the operator is not defined on.
+auto BinaryOperation(OpCode op, const Value& lhs, const Value& rhs) -> Value;
+
+auto UnaryOperation(OpCode op, const Value& operand) -> Value;
+
+auto IndexValue(const Value& container, const Value& index) -> Value;
+
+auto SliceValue(const Value& container, const Value* begin, const Value* end) -> Value;
+
+void SetIndexValue(const Value& container, const Value& index, Value value);
@@ -0,0 +1,38 @@
+#include "OutputBuffer.h"
+
+OutputBuffer::OutputBuffer(std::ostream& stream, size_t threshold, std::pmr::memory_resource* resource)
+    : stream_(stream)
+    , buffer_(resource)
+    , threshold_(threshold) {
+}
+
+OutputBuffer::~OutputBuffer() {
+    Flush();
+}
+
+void OutputBuffer::Write(const Value& value) {
+    AppendValue(buffer_, value);
+    FlushIfFull();
+}
+
+void OutputBuffer::Write(char c) {
+    buffer_ += c;
+    FlushIfFull();
+}
+
+void OutputBuffer::Flush() {
+    if (!buffer_.empty()) {
+        stream_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+}
+
+void OutputBuffer::SetThreshold(size_t threshold) noexcept {
+    threshold_ = threshold;
+}
+
+void OutputBuffer::FlushIfFull() {
+    if (buffer_.size() >= threshold_) {
+        Flush();
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "Value.h"
+
+// Collects print()/println() output and hands it to the target stream in
+// large writes instead of one stream call per value. The interpreter flushes
+// it before read(), when a Resume() returns and once `threshold` bytes are
+// pending; a threshold of zero writes through on every call.
+class OutputBuffer {
+public:
+    static constexpr size_t kDefaultThreshold = 16 * 1024;
+
+    explicit OutputBuffer(std::ostream& stream, size_t threshold = kDefaultThreshold,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void Write(const Value& value);
+    void Write(char c);
+
+    void Flush();
+    void SetThreshold(size_t threshold) noexcept;
+
+private:
+    std::ostream& stream_;
+    std::pmr::string buffer_;
+    size_t threshold_;
+
+    void FlushIfFull();
+};
@@ -0,0 +1,217 @@
+#include "ParallelBuiltins.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "WorkStealingPool.h"
+#include "interpreter.h"
+
+static constexpr size_t kParallelThreshold = 4096;
+static constexpr size_t kMinChunkSize = 1024;
+static constexpr size_t kChunksPerThread = 4;
+
+static auto expect_list(const Value& value, std::string_view function) -> ListPtr {
+    const auto* list = std::get_if<ListPtr>(&value);
+    if (list == nullptr) {
+        throw ScriptError(std::string(function) + "() expects a list as argument 1, got " + std::string(TypeName(value)));
+    }
+
+    return *list;
+}
+
+static void expect_callable(const Value& value, std::string_view function, size_t position = 2) {
+    if (!std::holds_alternative<Function>(value) && !std::holds_alternative<Builtin>(value)) {
+        throw ScriptError(std::string(function) + "() expects a function as argument " + std::to_string(position) +
+                          ", got " + std::string(TypeName(value)));
+    }
+}
+
+static bool can_run_parallel(const Interpreter& interpreter, const Value& function, size_t size) {
+    if (interpreter.IsWorker() || interpreter.GetWorkerPool() == nullptr || size < kParallelThreshold) {
+        return false;
+    }
+
+    const auto* script_function = std::get_if<Function>(&function);
+    return script_function == nullptr || !interpreter.IsKnownImpure(script_function->proto);
+}
+
+struct ChunkPlan {
+    size_t count;
+    size_t size;
+};
+
+static auto plan_chunks(const Interpreter& interpreter, size_t size) -> ChunkPlan {
+    size_t max_chunks = interpreter.GetWorkerPool()->GetThreadCount() * kChunksPerThread;
+    size_t count = std::clamp<size_t>(size / kMinChunkSize, 1, max_chunks);
+    size_t chunk_size = (size + count - 1) / count;
+
+    return {(size + chunk_size - 1) / chunk_size, chunk_size};
+}
+
+// Runs body(worker, chunk, begin, end) for every chunk on the pool. Returns
+// false if any chunk failed; the caller then redoes the work sequentially so
+// errors and side effects surface exactly as in a plain loop. Chunks allocate
+// from the default resource even when the calling thread helps out, as the
+// script's own resource is not shared across threads, but charge the
+// script's memory account wherever they run. Workers share the remaining
+// instruction budget and their instructions count towards the script's.
+template<class Body>
+static bool run_chunks(Interpreter& interpreter, const Value& function, size_t size, const ChunkPlan& plan, Body body) {
+    WorkStealingPool& pool = *interpreter.GetWorkerPool();
+    std::shared_ptr<MemoryAccount> memory = interpreter.GetMemoryAccount();
+    std::atomic<size_t> instructions = 0;
+    std::atomic<size_t> remaining = plan.count;
+    std::atomic<bool> failed = false;
+    std::atomic<bool> impure = false;
+
+    for (size_t chunk = 0; chunk < plan.count; ++chunk) {
+        pool.Submit([&, chunk] {
+            size_t begin = chunk * plan.size;
+            size_t end = std::min(size, begin + plan.size);
+            if (!failed.load()) {
+                try {
+                    ScopedMemoryAccount account(memory);
+                    ScopedMemoryResource resource(std::pmr::get_default_resource());
+                    Interpreter worker = interpreter.MakeWorker(plan.count);
+                    try {
+                        body(worker, chunk, begin, end);
+                    } catch (const SideEffectError&) {
+                        impure = true;
+                        failed = true;
+                    } catch (...) {
+                        failed = true;
+                    }
+                    instructions.fetch_add(worker.GetInstructionCount());
+                } catch (...) {
+                    failed = true;
+                }
+            }
+            remaining.fetch_sub(1);
+        });
+    }
+    pool.WaitFor(remaining);
+    interpreter.AddInstructions(instructions.load());
+
+    if (impure.load()) {
+        if (const auto* script_function = std::get_if<Function>(&function)) {
+            interpreter.MarkImpure(script_function->proto);
+        }
+    }
+
+    return !failed.load();
+}
+
+auto BuiltinParallelMap(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    ListPtr list = expect_list(args[0], "pmap");
+    Value function = args[1];
+    expect_callable(function, "pmap");
+
+    // A repeated view can be far longer than the storage behind it.
+    const List& items = *list;
+    CheckMemory(items.GetSize() * sizeof(Value));
+    if (can_run_parallel(interpreter, function, items.GetSize())) {
+        ChunkPlan plan = plan_chunks(interpreter, items.GetSize());
+        std::pmr::vector<Value> result(items.GetSize(), GetMemoryResource());
+        bool done = run_chunks(interpreter, function, items.GetSize(), plan,
+            [&](Interpreter& worker, size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    result[i] = worker.CallFunction(function, {&items[i], 1});
+                }
+            });
+        if (done) {
+            return MakeList(std::move(result));
+        }
+    }
+
+    std::pmr::vector<Value> result(GetMemoryResource());
+    result.reserve(items.GetSize());
+    for (size_t i = 0; i < items.GetSize(); ++i) {
+        Value item = items[i];
+        result.push_back(interpreter.CallFunction(function, {&item, 1}));
+    }
+
+    return MakeList(std::move(result));
+}
+
+auto BuiltinParallelFilter(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    ListPtr list = expect_list(args[0], "pfilter");
+    Value function = args[1];
+    expect_callable(function, "pfilter");
+
+    const List& items = *list;
+    if (can_run_parallel(interpreter, function, items.GetSize())) {
+        ChunkPlan plan = plan_chunks(interpreter, items.GetSize());
+        std::vector<char> keep(items.GetSize(), false);
+        bool done = run_chunks(interpreter, function, items.GetSize(), plan,
+            [&](Interpreter& worker, size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    keep[i] = IsTruthy(worker.CallFunction(function, {&items[i], 1}));
+                }
+            });
+        if (done) {
+            std::pmr::vector<Value> result(GetMemoryResource());
+            for (size_t i = 0; i < items.GetSize(); ++i) {
+                if (keep[i]) {
+                    AppendChecked(result, items[i]);
+                }
+            }
+            return MakeList(std::move(result));
+        }
+    }
+
+    std::pmr::vector<Value> result(GetMemoryResource());
+    for (size_t i = 0; i < items.GetSize(); ++i) {
+        Value item = items[i];
+        if (IsTruthy(interpreter.CallFunction(function, {&item, 1}))) {
+            AppendChecked(result, std::move(item));
+        }
+    }
+
+    return MakeList(std::move(result));
+}
+
+auto BuiltinParallelReduce(Interpreter& interpreter, std::span<const Value> args) -> Value {
+    ListPtr list = expect_list(args[0], "preduce");
+    Value function = args[1];
+    Value accumulator = args[2];
+    expect_callable(function, "preduce");
+
+    const Value* combine = nullptr;
+    if (args.size() > 3) {
+        combine = &args[3];
+        expect_callable(*combine, "preduce", 4);
+    }
+
+    const List& items = *list;
+    // f(acc, x) alone cannot merge two partial results, so only a call with
+    // `combine` is split. Every chunk folds from `init`; the partial results
+    // are combined on this interpreter, in chunk order.
+    if (combine != nullptr && can_run_parallel(interpreter, function, items.GetSize())) {
+        ChunkPlan plan = plan_chunks(interpreter, items.GetSize());
+        std::vector<Value> partial(plan.count);
+        bool done = run_chunks(interpreter, function, items.GetSize(), plan,
+            [&](Interpreter& worker, size_t chunk, size_t begin, size_t end) {
+                Value value = accumulator;
+                for (size_t i = begin; i < end; ++i) {
+                    Value pair[] = {std::move(value), items[i]};
+                    value = worker.CallFunction(function, pair);
+                }
+                partial[chunk] = std::move(value);
+            });
+        if (done) {
+            Value result = std::move(partial[0]);
+            for (size_t chunk = 1; chunk < plan.count; ++chunk) {
+                Value pair[] = {std::move(result), std::move(partial[chunk])};
+                result = interpreter.CallFunction(*combine, pair);
+            }
+            return result;
+        }
+    }
+
+    for (size_t i = 0; i < items.GetSize(); ++i) {
+        Value pair[] = {std::move(accumulator), items[i]};
+        accumulator = interpreter.CallFunction(function, pair);
+    }
+
+    return accumulator;
+}
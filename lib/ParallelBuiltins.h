@@ -0,0 +1,18 @@
+#pragma once
+
+#include <span>
+
+#include "Value.h"
+
+class Interpreter;
+
+// pmap(list, f), pfilter(list, f) and preduce(list, f, init[, combine]).
+// Large lists are split into chunks evaluated by worker interpreters on the
+// interpreter's pool; callbacks with side effects make them fall back to
+// sequential order. preduce folds each chunk from `init` and merges the
+// results with combine(a, b), so `init` must be an identity of `combine` and
+// combining two folds must equal folding both ranges; without `combine` it
+// always folds sequentially.
+auto BuiltinParallelMap(Interpreter& interpreter, std::span<const Value> args) -> Value;
+auto BuiltinParallelFilter(Interpreter& interpreter, std::span<const Value> args) -> Value;
+auto BuiltinParallelReduce(Interpreter& interpreter, std::span<const Value> args) -> Value;
@@ -0,0 +1,98 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <utility>
+
+auto Profiler::StackHash::operator()(std::span<const Frame> stack) const noexcept -> size_t {
+    size_t hash = stack.size();
+    for (const Frame& frame : stack) {
+        hash = (hash ^ reinterpret_cast<size_t>(frame.proto) ^ frame.ip) * 0x100000001b3;
+    }
+
+    return hash;
+}
+
+bool Profiler::StackEqual::operator()(std::span<const Frame> lhs, std::span<const Frame> rhs) const noexcept {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+void Profiler::Record(std::span<const Frame> stack) {
+    ++samples_;
+    if (auto it = stacks_.find(stack); it != stacks_.end()) {
+        ++it->second;
+        return;
+    }
+
+    stacks_.emplace(std::vector<Frame>(stack.begin(), stack.end()), 1);
+}
+
+auto Profiler::GetSampleCount() const noexcept -> size_t {
+    return samples_;
+}
+
+void Profiler::WriteCollapsed(std::ostream& out) const {
+    // Sorted, so that the output of two runs can be diffed.
+    std::map<std::string, size_t> lines;
+    std::map<std::pair<const FunctionProto*, size_t>, std::string> labels;
+    for (const auto& [stack, count] : stacks_) {
+        std::string line;
+        for (const Frame& frame : stack) {
+            auto [it, inserted] = labels.try_emplace({frame.proto, frame.ip});
+            if (inserted) {
+                it->second = frame.proto->name + ':' + std::to_string(frame.proto->rows[frame.ip] + 1) + ':' +
+                             std::to_string(frame.proto->columns[frame.ip] + 1);
+            }
+            if (!line.empty()) {
+                line += ';';
+            }
+            line += it->second;
+        }
+        lines[std::move(line)] += count;
+    }
+
+    for (const auto& [line, count] : lines) {
+        out << line << ' ' << count << '\n';
+    }
+}
+
+void Profiler::WriteLineTable(std::ostream& out) const {
+    struct LineHits {
+        size_t self = 0;
+        size_t total = 0;
+    };
+
+    using Line = std::pair<size_t, const FunctionProto*>;
+    std::map<Line, LineHits> hits;
+    std::set<Line> seen;
+    for (const auto& [stack, count] : stacks_) {
+        // A recursive call puts a line on the stack more than once.
+        seen.clear();
+        for (const Frame& frame : stack) {
+            Line line{frame.proto->rows[frame.ip], frame.proto};
+            if (seen.insert(line).second) {
+                hits[line].total += count;
+            }
+        }
+        const Frame& top = stack.back();
+        hits[{top.proto->rows[top.ip], top.proto}].self += count;
+    }
+
+    std::vector<std::pair<Line, LineHits>> sorted(hits.begin(), hits.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second.self != rhs.second.self ? lhs.second.self > rhs.second.self
+                                                  : lhs.second.total > rhs.second.total;
+    });
+
+    auto percent = [this](size_t count) { return 100.0 * static_cast<double>(count) / static_cast<double>(samples_); };
+    out << std::setw(10) << "self" << std::setw(8) << '%' << std::setw(10) << "total" << std::setw(8) << '%'
+        << "  line  function\n"
+        << std::fixed << std::setprecision(1);
+    for (const auto& [line, count] : sorted) {
+        out << std::setw(10) << count.self << std::setw(8) << percent(count.self) << std::setw(10) << count.total
+            << std::setw(8) << percent(count.total) << "  " << std::left << std::setw(6) << line.first + 1
+            << std::right << line.second->name << '\n';
+    }
+}
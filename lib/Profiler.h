@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "Bytecode.h"
+
+// Call-stack samples of a script, taken by the interpreter every few
+// thousand instructions (see Interpreter::SetProfiler). Identical stacks are
+// counted together, so memory grows with the number of distinct stacks, not
+// with the run time.
+class Profiler {
+public:
+    static constexpr size_t kDefaultInterval = 4000;
+
+    // An instruction being executed: the current one for the innermost
+    // frame, the pending call for the others.
+    struct Frame {
+        const FunctionProto* proto;
+        size_t ip;
+
+        bool operator==(const Frame&) const = default;
+    };
+
+    // `stack` lists the outermost frame first.
+    void Record(std::span<const Frame> stack);
+
+    auto GetSampleCount() const noexcept -> size_t;
+
+    // One "frame;frame;... count" line per distinct stack, the format
+    // flamegraph.pl and speedscope read. Frames are "function:line:column".
+    void WriteCollapsed(std::ostream& out) const;
+    // Samples per source line, hottest first: "self" counts samples
+    // executing the line, "total" also those in functions it called.
+    void WriteLineTable(std::ostream& out) const;
+
+private:
+    struct StackHash {
+        using is_transparent = void;
+        auto operator()(std::span<const Frame> stack) const noexcept -> size_t;
+    };
+
+    struct StackEqual {
+        using is_transparent = void;
+        bool operator()(std::span<const Frame> lhs, std::span<const Frame> rhs) const noexcept;
+    };
+
+    std::unordered_map<std::vector<Frame>, size_t, StackHash, StackEqual> stacks_;
+    size_t samples_ = 0;
+};
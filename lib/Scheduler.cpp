@@ -0,0 +1,221 @@
+#include "Scheduler.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "AsyncIo.h"
+#include "Bytecode.h"
+
+static constexpr int kMaxEvents = 64;
+
+Scheduler::Scheduler(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ == -1 || wake_fd_ == -1) {
+        throw std::system_error(errno, std::system_category(), "cannot create the I/O reactor");
+    }
+    epoll_event wake{};
+    wake.events = EPOLLIN;
+    wake.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake);
+
+    reactor_ = std::thread(&Scheduler::ReactorLoop, this);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back(&Scheduler::WorkerLoop, this);
+    }
+}
+
+Scheduler::~Scheduler() {
+    Wait();
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    uint64_t one = 1;
+    (void)!write(wake_fd_, &one, sizeof(one));
+
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    reactor_.join();
+
+    close(wake_fd_);
+    close(epoll_fd_);
+}
+
+void Scheduler::SetWorkerPool(WorkStealingPool* pool) noexcept {
+    pool_ = pool;
+}
+
+void Scheduler::Spawn(std::shared_ptr<const CompiledProgram> program, std::istream& input, std::ostream& output,
+                      const ScriptLimits& limits, Callback on_done,
+                      std::unique_ptr<std::pmr::memory_resource> resource) {
+    std::pmr::memory_resource* raw = resource ? resource.get() : std::pmr::get_default_resource();
+    std::unique_ptr<Script> script(new Script{
+        std::move(resource),
+        Interpreter(std::move(program), input, output, raw),
+        limits.time_slice == 0 ? Interpreter::kUnlimitedFuel : limits.time_slice,
+        std::move(on_done),
+        {},
+        std::nullopt,
+    });
+    script->interpreter.SetWorkerPool(pool_);
+    script->interpreter.SetInstructionBudget(limits.max_instructions);
+    script->interpreter.SetMemoryBudget(limits.max_memory);
+    script->interpreter.Start();
+
+    {
+        std::lock_guard lock(mutex_);
+        ++active_;
+        run_queue_.push_back(std::move(script));
+    }
+    wake_.notify_one();
+}
+
+void Scheduler::Wait() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this] { return active_ == 0; });
+}
+
+auto Scheduler::GetThreadCount() const noexcept -> size_t {
+    return threads_.size();
+}
+
+void Scheduler::WorkerLoop() {
+    while (true) {
+        std::unique_ptr<Script> script;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !run_queue_.empty(); });
+            if (run_queue_.empty()) {
+                return;
+            }
+            script = std::move(run_queue_.front());
+            run_queue_.pop_front();
+        }
+
+        Interpreter& interpreter = script->interpreter;
+        auto* output = dynamic_cast<AsyncOutput*>(interpreter.GetOutput().rdbuf());
+
+        ExecutionStatus status;
+        if (script->result) {
+            status = *script->result;
+        } else {
+            auto start = std::chrono::steady_clock::now();
+            status = interpreter.Resume(script->time_slice);
+            script->run_time += std::chrono::steady_clock::now() - start;
+        }
+
+        if (status == ExecutionStatus::kSuspended) {
+            if (output != nullptr) {
+                output->Flush();
+            }
+            Requeue(std::move(script));
+            continue;
+        }
+        if (status == ExecutionStatus::kBlocked) {
+            Park(std::move(script), interpreter.GetIoWait());
+            continue;
+        }
+
+        script->result = status;
+        if (output != nullptr && !output->Flush()) {
+            Park(std::move(script), {output->GetFd(), true});
+            continue;
+        }
+
+        Finish(*script, status);
+        script.reset();
+
+        std::lock_guard lock(mutex_);
+        if (--active_ == 0) {
+            idle_.notify_all();
+        }
+    }
+}
+
+void Scheduler::ReactorLoop() {
+    epoll_event events[kMaxEvents];
+    while (true) {
+        int count = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+        if (count == -1) {
+            continue;
+        }
+
+        std::lock_guard lock(mutex_);
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                if (stop_) {
+                    return;
+                }
+                continue;
+            }
+
+            auto it = waiting_.find(fd);
+            if (it == waiting_.end()) {
+                continue;
+            }
+            for (auto& script : it->second.scripts) {
+                run_queue_.push_back(std::move(script));
+            }
+            waiting_.erase(it);
+        }
+        wake_.notify_all();
+    }
+}
+
+void Scheduler::Requeue(std::unique_ptr<Script> script) {
+    {
+        std::lock_guard lock(mutex_);
+        run_queue_.push_back(std::move(script));
+    }
+    wake_.notify_one();
+}
+
+// Registers the script with the reactor. The descriptor is armed one-shot
+// for the union of what its waiters need; descriptors epoll cannot watch
+// (regular files) are always ready, so those scripts go straight back.
+void Scheduler::Park(std::unique_ptr<Script> script, const IoWait& wait) {
+    std::unique_lock lock(mutex_);
+    Waiters& waiters = waiting_[wait.fd];
+    waiters.events |= wait.write ? EPOLLOUT : EPOLLIN;
+    waiters.scripts.push_back(std::move(script));
+
+    epoll_event event{};
+    event.events = waiters.events | EPOLLONESHOT;
+    event.data.fd = wait.fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, wait.fd, &event) == 0 ||
+        (errno == ENOENT && epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wait.fd, &event) == 0)) {
+        return;
+    }
+
+    for (auto& waiter : waiters.scripts) {
+        run_queue_.push_back(std::move(waiter));
+    }
+    waiting_.erase(wait.fd);
+    lock.unlock();
+    wake_.notify_all();
+}
+
+void Scheduler::Finish(Script& script, ExecutionStatus status) {
+    if (!script.on_done) {
+        return;
+    }
+
+    ScriptOutcome outcome;
+    outcome.success = status == ExecutionStatus::kFinished;
+    outcome.error = script.interpreter.GetError();
+    outcome.instructions = script.interpreter.GetInstructionCount();
+    outcome.run_time = script.run_time;
+    script.on_done(outcome);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "interpreter.h"
+
+class CompiledProgram;
+class WorkStealingPool;
+
+struct ScriptLimits {
+    // Instructions a script may run before it yields its thread to the next
+    // script in the queue.
+    size_t time_slice = 10000;
+    // Total instructions and live bytes of strings and lists; zero means
+    // unlimited.
+    size_t max_instructions = 0;
+    size_t max_memory = 0;
+};
+
+struct ScriptOutcome {
+    bool success = false;
+    std::string error;
+    size_t instructions = 0;
+    // Time spent running, summed over all slices.
+    std::chrono::duration<double, std::milli> run_time{};
+};
+
+// M:N scheduler for scripts. Every script is a suspended interpreter waiting
+// in one FIFO run queue; a fixed set of threads resumes them one time slice
+// at a time, so a runaway loop only delays the others instead of holding a
+// thread forever. Scripts whose AsyncInput/AsyncOutput is not ready are
+// parked on an epoll reactor and requeued once the descriptor is.
+class Scheduler {
+public:
+    using Callback = std::function<void(const ScriptOutcome&)>;
+
+    explicit Scheduler(size_t thread_count = std::thread::hardware_concurrency());
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Pool handed to the interpreters of scripts spawned afterwards, for the
+    // parallel built-ins.
+    void SetWorkerPool(WorkStealingPool* pool) noexcept;
+
+    // The streams must outlive the script. `on_done` runs on a scheduler
+    // thread once the script has finished or failed. The script's values are
+    // allocated from `resource` if given; it is released with the script.
+    // May be called from any thread.
+    void Spawn(std::shared_ptr<const CompiledProgram> program, std::istream& input, std::ostream& output,
+               const ScriptLimits& limits, Callback on_done,
+               std::unique_ptr<std::pmr::memory_resource> resource = nullptr);
+
+    // Blocks until every spawned script is done.
+    void Wait();
+
+    auto GetThreadCount() const noexcept -> size_t;
+
+private:
+    struct Script {
+        // Declared first so it outlives everything allocated from it.
+        std::unique_ptr<std::pmr::memory_resource> resource;
+        Interpreter interpreter;
+        size_t time_slice;
+        Callback on_done;
+        std::chrono::duration<double, std::milli> run_time{};
+        // Set once the script is done while its output is still draining.
+        std::optional<ExecutionStatus> result;
+    };
+
+    struct Waiters {
+        uint32_t events = 0;
+        std::vector<std::unique_ptr<Script>> scripts;
+    };
+
+    std::vector<std::thread> threads_;
+    std::thread reactor_;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    WorkStealingPool* pool_ = nullptr;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<std::unique_ptr<Script>> run_queue_;
+    std::unordered_map<int, Waiters> waiting_;
+    size_t active_ = 0;
+    bool stop_ = false;
+
+    void WorkerLoop();
+    void ReactorLoop();
+    void Requeue(std::unique_ptr<Script> script);
+    void Park(std::unique_ptr<Script> script, const IoWait& wait);
+    void Finish(Script& script, ExecutionStatus status);
+};
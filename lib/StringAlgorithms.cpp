@@ -0,0 +1,195 @@
+#include "StringAlgorithms.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#if defined(__AVX2__)
+
+struct Simd {
+    using Vector = __m256i;
+    static constexpr size_t kWidth = 32;
+
+    static auto Load(const char* data) noexcept -> Vector {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    }
+    static void Store(char* data, Vector vector) noexcept {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data), vector);
+    }
+    static auto Splat(char c) noexcept -> Vector {
+        return _mm256_set1_epi8(c);
+    }
+    static auto Equal(Vector a, Vector b) noexcept -> Vector {
+        return _mm256_cmpeq_epi8(a, b);
+    }
+    static auto Less(Vector a, Vector b) noexcept -> Vector {
+        return _mm256_cmpgt_epi8(b, a);
+    }
+    static auto And(Vector a, Vector b) noexcept -> Vector {
+        return _mm256_and_si256(a, b);
+    }
+    static auto Add(Vector a, Vector b) noexcept -> Vector {
+        return _mm256_add_epi8(a, b);
+    }
+    static auto Mask(Vector vector) noexcept -> uint32_t {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(vector));
+    }
+};
+
+#elif defined(__SSE2__)
+
+struct Simd {
+    using Vector = __m128i;
+    static constexpr size_t kWidth = 16;
+
+    static auto Load(const char* data) noexcept -> Vector {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+    static void Store(char* data, Vector vector) noexcept {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data), vector);
+    }
+    static auto Splat(char c) noexcept -> Vector {
+        return _mm_set1_epi8(c);
+    }
+    static auto Equal(Vector a, Vector b) noexcept -> Vector {
+        return _mm_cmpeq_epi8(a, b);
+    }
+    static auto Less(Vector a, Vector b) noexcept -> Vector {
+        return _mm_cmplt_epi8(a, b);
+    }
+    static auto And(Vector a, Vector b) noexcept -> Vector {
+        return _mm_and_si128(a, b);
+    }
+    static auto Add(Vector a, Vector b) noexcept -> Vector {
+        return _mm_add_epi8(a, b);
+    }
+    static auto Mask(Vector vector) noexcept -> uint32_t {
+        return static_cast<uint32_t>(_mm_movemask_epi8(vector));
+    }
+};
+
+#endif
+
+} // namespace
+
+// Adds `delta` to every byte in [first, first + 25], i.e. one letter range.
+// Signed compares only, so bytes are shifted to put `first` at -128 first.
+static void shift_letters(char* data, size_t size, char first, char delta) noexcept {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const auto offset = Simd::Splat(static_cast<char>(-128 - first));
+    const auto limit = Simd::Splat(static_cast<char>(-128 + 26));
+    const auto change = Simd::Splat(delta);
+    for (; i + Simd::kWidth <= size; i += Simd::kWidth) {
+        auto block = Simd::Load(data + i);
+        auto in_range = Simd::Less(Simd::Add(block, offset), limit);
+        Simd::Store(data + i, Simd::Add(block, Simd::And(in_range, change)));
+    }
+#endif
+    for (; i < size; ++i) {
+        if (static_cast<unsigned char>(data[i] - first) < 26) {
+            data[i] = static_cast<char>(data[i] + delta);
+        }
+    }
+}
+
+
+// Candidate positions are the ones where both the first and the last byte of
+// the needle match; only those are compared in full.
+auto FindSubstring(std::string_view haystack, std::string_view needle, size_t from) noexcept -> size_t {
+    if (from > haystack.size() || needle.size() > haystack.size() - from) {
+        return std::string_view::npos;
+    }
+    if (needle.empty()) {
+        return from;
+    }
+    if (needle.size() == 1) {
+        const void* found = std::memchr(haystack.data() + from, needle[0], haystack.size() - from);
+        return found == nullptr ? std::string_view::npos
+                                : static_cast<size_t>(static_cast<const char*>(found) - haystack.data());
+    }
+
+    size_t i = from;
+#if defined(__SSE2__)
+    const char* data = haystack.data();
+    const size_t last = needle.size() - 1;
+    const auto first_byte = Simd::Splat(needle.front());
+    const auto last_byte = Simd::Splat(needle.back());
+    for (; i + last + Simd::kWidth <= haystack.size(); i += Simd::kWidth) {
+        uint32_t mask = Simd::Mask(Simd::And(Simd::Equal(Simd::Load(data + i), first_byte),
+                                             Simd::Equal(Simd::Load(data + i + last), last_byte)));
+        while (mask != 0) {
+            size_t position = i + static_cast<size_t>(__builtin_ctz(mask));
+            if (std::memcmp(data + position + 1, needle.data() + 1, last - 1) == 0) {
+                return position;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    return haystack.find(needle, i);
+}
+
+void AsciiToLower(char* data, size_t size) noexcept {
+    shift_letters(data, size, 'A', 'a' - 'A');
+}
+
+void AsciiToUpper(char* data, size_t size) noexcept {
+    shift_letters(data, size, 'a', 'A' - 'a');
+}
+
+static bool is_continuation(char c) noexcept {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+auto ScanText(std::string_view text) noexcept -> TextInfo {
+    const char* data = text.data();
+    size_t continuations = 0;
+    bool ascii = true;
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    // Continuation bytes 0x80..0xBF are exactly the signed bytes below -64.
+    const auto limit = Simd::Splat(static_cast<char>(0xC0));
+    for (; i + Simd::kWidth <= text.size(); i += Simd::kWidth) {
+        auto block = Simd::Load(data + i);
+        if (Simd::Mask(block) != 0) {
+            ascii = false;
+            continuations += static_cast<size_t>(__builtin_popcount(Simd::Mask(Simd::Less(block, limit))));
+        }
+    }
+#endif
+    for (; i < text.size(); ++i) {
+        ascii = ascii && static_cast<unsigned char>(data[i]) < 0x80;
+        continuations += is_continuation(data[i]) ? 1 : 0;
+    }
+
+    // A stray continuation byte at the very start still begins a code point.
+    if (!text.empty() && is_continuation(data[0])) {
+        --continuations;
+    }
+
+    return {text.size() - continuations, ascii};
+}
+
+auto CodePointOffset(std::string_view text, size_t index) noexcept -> size_t {
+    if (index == 0) {
+        return 0;
+    }
+
+    for (size_t offset = 1; offset < text.size(); ++offset) {
+        if (!is_continuation(text[offset]) && --index == 0) {
+            return offset;
+        }
+    }
+
+    return text.size();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Byte-string kernels behind the string built-ins. They use SSE2 (AVX2 when
+// the build targets it) on x86 and plain loops elsewhere; results are the
+// same either way.
+
+// Position of `needle` in `haystack` at or after `from`, or npos.
+auto FindSubstring(std::string_view haystack, std::string_view needle, size_t from = 0) noexcept -> size_t;
+
+// Case conversion of the ASCII letters; other bytes are left alone, which is
+// what tolower/toupper do in the "C" locale.
+void AsciiToLower(char* data, size_t size) noexcept;
+void AsciiToUpper(char* data, size_t size) noexcept;
+
+struct TextInfo {
+    size_t code_points;
+    bool ascii;
+};
+
+// UTF-8 code points start at offset 0 and at every byte that does not
+// continue a sequence (10xxxxxx), so malformed input still gets a
+// consistent answer.
+auto ScanText(std::string_view text) noexcept -> TextInfo;
+
+// Byte offset of code point `index`; text.size() when index is the count.
+auto CodePointOffset(std::string_view text, size_t index) noexcept -> size_t;
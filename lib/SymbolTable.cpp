@@ -0,0 +1,70 @@
+#include "SymbolTable.h"
+
+#include <functional>
+
+static constexpr size_t kInitialCapacity = 64;
+
+auto SymbolTable::Intern(std::string_view name) -> uint32_t {
+    // Keep the load factor under 1/2 so probe sequences stay short.
+    if ((names_.size() + 1) * 2 > slots_.size()) {
+        Rehash(slots_.empty() ? kInitialCapacity : slots_.size() * 2);
+    }
+
+    size_t hash = std::hash<std::string_view>{}(name);
+    Slot& slot = slots_[Probe(name, hash)];
+    if (slot.id == kEmpty) {
+        slot = {hash, static_cast<uint32_t>(names_.size())};
+        names_.emplace_back(name);
+    }
+
+    return slot.id;
+}
+
+auto SymbolTable::Find(std::string_view name) const noexcept -> std::optional<uint32_t> {
+    if (slots_.empty()) {
+        return std::nullopt;
+    }
+
+    const Slot& slot = slots_[Probe(name, std::hash<std::string_view>{}(name))];
+    if (slot.id == kEmpty) {
+        return std::nullopt;
+    }
+
+    return slot.id;
+}
+
+auto SymbolTable::GetName(uint32_t id) const noexcept -> const std::string& {
+    return names_[id];
+}
+
+auto SymbolTable::GetSize() const noexcept -> size_t {
+    return names_.size();
+}
+
+// Index of the slot holding `name`, or of the empty slot where it belongs.
+auto SymbolTable::Probe(std::string_view name, size_t hash) const noexcept -> size_t {
+    size_t mask = slots_.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        const Slot& slot = slots_[index];
+        if (slot.id == kEmpty || (slot.hash == hash && names_[slot.id] == name)) {
+            return index;
+        }
+    }
+}
+
+void SymbolTable::Rehash(size_t capacity) {
+    std::vector<Slot> old = std::move(slots_);
+    slots_.assign(capacity, Slot{});
+
+    size_t mask = capacity - 1;
+    for (const Slot& slot : old) {
+        if (slot.id == kEmpty) {
+            continue;
+        }
+        size_t index = slot.hash & mask;
+        while (slots_[index].id != kEmpty) {
+            index = (index + 1) & mask;
+        }
+        slots_[index] = slot;
+    }
+}
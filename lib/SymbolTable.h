@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Interns global names into dense ids. Lookup is open addressing with linear
+// probing over a power-of-two slot array. Ids never change once handed out,
+// so compiled code uses them directly as indices into an interpreter's
+// global slots.
+class SymbolTable {
+public:
+    auto Intern(std::string_view name) -> uint32_t;
+    auto Find(std::string_view name) const noexcept -> std::optional<uint32_t>;
+
+    auto GetName(uint32_t id) const noexcept -> const std::string&;
+    auto GetSize() const noexcept -> size_t;
+
+private:
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+
+    struct Slot {
+        size_t hash = 0;
+        uint32_t id = kEmpty;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<std::string> names_;
+
+    auto Probe(std::string_view name, size_t hash) const noexcept -> size_t;
+    void Rehash(size_t capacity);
+};
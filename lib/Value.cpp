@@ -0,0 +1,552 @@
+#include "Value.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+#include "Builtins.h"
+#include "Bytecode.h"
+#include "StringAlgorithms.h"
+
+static constexpr double kMaxExactInteger = 9007199254740992.0;
+
+static thread_local std::shared_ptr<MemoryAccount> current_account;
+static thread_local std::pmr::memory_resource* current_resource = nullptr;
+
+String::String(std::pmr::string text) noexcept
+    : storage_(std::move(text))
+    , text_(storage_)
+    , hash_(std::hash<std::string_view>{}(text_)) {
+    TextInfo info = ScanText(text_);
+    length_ = info.code_points;
+    ascii_ = info.ascii;
+}
+
+String::String(StringPtr source, std::string_view part) noexcept
+    : source_(source->source_ ? source->source_ : std::move(source))
+    , text_(part)
+    , hash_(std::hash<std::string_view>{}(text_)) {
+    TextInfo info = ScanText(text_);
+    length_ = info.code_points;
+    ascii_ = info.ascii;
+}
+
+auto String::GetText() const noexcept -> std::string_view {
+    return text_;
+}
+
+auto String::GetSize() const noexcept -> size_t {
+    return text_.size();
+}
+
+auto String::GetLength() const noexcept -> size_t {
+    return length_;
+}
+
+auto String::GetHash() const noexcept -> size_t {
+    return hash_;
+}
+
+bool String::IsAscii() const noexcept {
+    return ascii_;
+}
+
+bool String::IsEmpty() const noexcept {
+    return text_.empty();
+}
+
+auto String::GetOffset(size_t index) const noexcept -> size_t {
+    if (ascii_ || index >= length_) {
+        return std::min(index, text_.size());
+    }
+
+    return CodePointOffset(text_, index);
+}
+
+auto String::CharAt(size_t index) const -> Value {
+    if (ascii_) {
+        return MakeCharString(text_[index]);
+    }
+
+    size_t begin = GetOffset(index);
+    return MakeString(text_.substr(begin, GetOffset(index + 1) - begin));
+}
+
+auto String::Substr(size_t from, size_t to) const noexcept -> std::string_view {
+    if (from >= to) {
+        return {};
+    }
+
+    size_t begin = GetOffset(from);
+    return text_.substr(begin, GetOffset(to) - begin);
+}
+
+bool operator==(const String& lhs, const String& rhs) noexcept {
+    return lhs.hash_ == rhs.hash_ && lhs.text_ == rhs.text_;
+}
+
+MemoryAccount::MemoryAccount(size_t limit) noexcept
+    : limit_(limit) {
+}
+
+static void throw_budget_exceeded(size_t limit) {
+    throw ScriptError("memory budget of " + std::to_string(limit) + " bytes exceeded");
+}
+
+void MemoryAccount::Charge(size_t bytes) {
+    size_t usage = usage_.fetch_add(bytes) + bytes;
+    if (limit_ != 0 && usage > limit_) {
+        usage_.fetch_sub(bytes);
+        throw_budget_exceeded(limit_);
+    }
+}
+
+void MemoryAccount::Check(size_t bytes) const {
+    size_t usage = usage_.load();
+    if (limit_ != 0 && (usage > limit_ || bytes > limit_ - usage)) {
+        throw_budget_exceeded(limit_);
+    }
+}
+
+void MemoryAccount::Credit(size_t bytes) noexcept {
+    usage_.fetch_sub(bytes);
+}
+
+auto MemoryAccount::GetUsage() const noexcept -> size_t {
+    return usage_.load();
+}
+
+auto GetMemoryResource() noexcept -> std::pmr::memory_resource* {
+    return current_resource != nullptr ? current_resource : std::pmr::get_default_resource();
+}
+
+ScopedMemoryResource::ScopedMemoryResource(std::pmr::memory_resource* resource) noexcept
+    : previous_(std::exchange(current_resource, resource)) {
+}
+
+ScopedMemoryResource::~ScopedMemoryResource() {
+    current_resource = previous_;
+}
+
+ScopedMemoryAccount::ScopedMemoryAccount(std::shared_ptr<MemoryAccount> account) noexcept
+    : previous_(std::exchange(current_account, std::move(account))) {
+}
+
+ScopedMemoryAccount::~ScopedMemoryAccount() {
+    current_account = std::move(previous_);
+}
+
+ListStorage::~ListStorage() {
+    if (account) {
+        account->Credit(items.size() * sizeof(Value));
+    }
+}
+
+void ListStorage::Grow(size_t count) {
+    if (account) {
+        account->Charge(count * sizeof(Value));
+    }
+}
+
+void ListStorage::Shrink(size_t count) noexcept {
+    if (account) {
+        account->Credit(count * sizeof(Value));
+    }
+}
+
+List::List(std::shared_ptr<ListStorage> storage) noexcept
+    : storage_(std::move(storage))
+    , period_(storage_->items.size())
+    , size_(period_) {
+}
+
+List::~List() {
+    if (storage_->account) {
+        storage_->account->Credit(sizeof(List));
+    }
+}
+
+auto List::Slice(size_t from, size_t to) const -> ListPtr {
+    if (from >= to) {
+        return std::get<ListPtr>(MakeList(std::pmr::vector<Value>(GetMemoryResource())));
+    }
+
+    return MakeView(offset_, period_, (phase_ + from) % period_, to - from);
+}
+
+auto List::Repeat(size_t size) const -> ListPtr {
+    if (size_ == 0 || size == 0) {
+        return std::get<ListPtr>(MakeList(std::pmr::vector<Value>(GetMemoryResource())));
+    }
+    if (phase_ == 0 && size_ % period_ == 0) {
+        return MakeView(offset_, period_, 0, size);
+    }
+
+    // A view that stops mid-cycle does not repeat with its own period.
+    CheckMemory(size_ * sizeof(Value));
+    std::pmr::vector<Value> items(GetMemoryResource());
+    items.reserve(size_);
+    for (size_t i = 0; i < size_; ++i) {
+        items.push_back((*this)[i]);
+    }
+    return std::get<ListPtr>(MakeList(std::move(items)))->Repeat(size);
+}
+
+auto List::MakeView(size_t offset, size_t period, size_t phase, size_t size) const -> ListPtr {
+    if (phase + size <= period) {
+        offset += phase;
+        period = size;
+        phase = 0;
+    }
+    if (storage_->account) {
+        storage_->account->Charge(sizeof(List));
+    }
+
+    auto view = std::allocate_shared<List>(std::pmr::polymorphic_allocator<>(GetMemoryResource()), storage_);
+    view->offset_ = offset;
+    view->period_ = period;
+    view->phase_ = phase;
+    view->size_ = size;
+    return view;
+}
+
+bool List::IsRepeated() const noexcept {
+    return phase_ + size_ > period_;
+}
+
+auto List::Own() -> std::pmr::vector<Value>& {
+    auto& items = storage_->items;
+    if (storage_.use_count() == 1 && !IsRepeated()) {
+        if (offset_ + size_ != items.size()) {
+            storage_->Shrink(items.size() - offset_ - size_);
+            items.resize(offset_ + size_);
+        }
+        // Free room in front may not outgrow the items, so a queue that keeps
+        // removing from the front pays O(1) amortized for the compaction.
+        if (offset_ > std::max(size_, kMinFrontRoom)) {
+            storage_->Shrink(offset_);
+            items.erase(items.begin(), items.begin() + static_cast<std::ptrdiff_t>(offset_));
+            offset_ = 0;
+        }
+        return items;
+    }
+
+    std::pmr::polymorphic_allocator<> allocator(GetMemoryResource());
+    auto storage = std::allocate_shared<ListStorage>(allocator, std::pmr::vector<Value>(allocator), storage_->account);
+    storage->Grow(size_);
+    storage->items.reserve(size_);
+    for (size_t i = 0; i < size_; ++i) {
+        storage->items.push_back((*this)[i]);
+    }
+
+    storage_ = std::move(storage);
+    offset_ = 0;
+    period_ = size_;
+    phase_ = 0;
+    return storage_->items;
+}
+
+void List::ReserveFront(std::pmr::vector<Value>& items) {
+    size_t room = std::max(size_, kMinFrontRoom);
+    storage_->Grow(room);
+    items.insert(items.begin(), room, Nil{});
+    offset_ += room;
+}
+
+void List::Set(size_t index, Value value) {
+    auto& items = Own();
+    items[offset_ + index] = std::move(value);
+}
+
+void List::Push(Value value) {
+    auto& items = Own();
+    storage_->Grow(1);
+    items.push_back(std::move(value));
+    period_ = ++size_;
+}
+
+auto List::Pop() -> Value {
+    auto& items = Own();
+    Value result = std::move(items.back());
+    items.pop_back();
+    storage_->Shrink(1);
+    period_ = --size_;
+    return result;
+}
+
+// Items in front of `index` move towards the front room when they are the
+// shorter side, so inserting and removing near either end is O(1) amortized.
+void List::Insert(size_t index, Value value) {
+    auto& items = Own();
+    auto first = static_cast<std::ptrdiff_t>(offset_);
+    auto position = first + static_cast<std::ptrdiff_t>(index);
+    if (index < size_ - index) {
+        if (offset_ == 0) {
+            ReserveFront(items);
+            first = static_cast<std::ptrdiff_t>(offset_);
+            position = first + static_cast<std::ptrdiff_t>(index);
+        }
+        std::move(items.begin() + first, items.begin() + position, items.begin() + first - 1);
+        items[static_cast<size_t>(position - 1)] = std::move(value);
+        --offset_;
+    } else {
+        storage_->Grow(1);
+        items.insert(items.begin() + position, std::move(value));
+    }
+    period_ = ++size_;
+}
+
+auto List::Remove(size_t index) -> Value {
+    auto& items = Own();
+    auto first = static_cast<std::ptrdiff_t>(offset_);
+    auto position = first + static_cast<std::ptrdiff_t>(index);
+    Value result = std::move(items[static_cast<size_t>(position)]);
+    if (index < size_ - index - 1) {
+        std::move_backward(items.begin() + first, items.begin() + position, items.begin() + position + 1);
+        items[offset_++] = Nil{};
+    } else {
+        items.erase(items.begin() + position);
+        storage_->Shrink(1);
+    }
+    period_ = --size_;
+    return result;
+}
+
+void List::Sort() {
+    auto& items = Own();
+    std::stable_sort(items.begin() + static_cast<std::ptrdiff_t>(offset_), items.end(), ValueLess);
+}
+
+auto MakeString(std::string_view text) -> Value {
+    return MakeString(std::pmr::string(text, GetMemoryResource()));
+}
+
+auto MakeString(const char* text) -> Value {
+    return MakeString(std::string_view(text));
+}
+
+// Allocates the string from the current resource and charges `bytes` for it
+// to the current account, if any, until it is destroyed.
+template<class... Args>
+static auto make_string(size_t bytes, Args&&... args) -> Value {
+    std::pmr::polymorphic_allocator<> allocator(GetMemoryResource());
+    if (!current_account) {
+        return std::allocate_shared<const String>(allocator, std::forward<Args>(args)...);
+    }
+
+    current_account->Charge(bytes);
+    auto release = [account = current_account, allocator, bytes](const String* str) mutable {
+        account->Credit(bytes);
+        allocator.delete_object(const_cast<String*>(str));
+    };
+    return StringPtr(allocator.new_object<String>(std::forward<Args>(args)...), std::move(release), allocator);
+}
+
+auto MakeString(std::pmr::string text) -> Value {
+    size_t bytes = sizeof(String) + text.size();
+    return make_string(bytes, std::move(text));
+}
+
+auto MakeStringPart(const StringPtr& source, std::string_view part) -> Value {
+    // Shorter text fits in the std::string itself.
+    if (part.size() < 16) {
+        return MakeString(part);
+    }
+
+    return make_string(sizeof(String), source, part);
+}
+
+auto MakeCharString(char c) -> Value {
+    static const auto strings = [] {
+        std::array<StringPtr, 256> strings;
+        for (size_t i = 0; i < strings.size(); ++i) {
+            strings[i] = std::make_shared<const String>(std::pmr::string(1, static_cast<char>(i)));
+        }
+        return strings;
+    }();
+
+    return strings[static_cast<unsigned char>(c)];
+}
+
+auto MakeList(std::pmr::vector<Value> items) -> Value {
+    std::shared_ptr<MemoryAccount> account;
+    if (current_account) {
+        current_account->Charge(sizeof(List) + items.size() * sizeof(Value));
+        account = current_account;
+    }
+
+    std::pmr::polymorphic_allocator<> allocator(GetMemoryResource());
+    auto storage = std::allocate_shared<ListStorage>(allocator, std::move(items), std::move(account));
+    return std::allocate_shared<List>(allocator, std::move(storage));
+}
+
+void CheckMemory(size_t bytes) {
+    if (current_account) {
+        current_account->Check(bytes);
+    }
+}
+
+void AppendChecked(std::pmr::vector<Value>& items, Value value) {
+    if (current_account && items.size() == items.capacity()) {
+        // The vector at least doubles, and holds both buffers while it moves.
+        current_account->Check(std::max<size_t>(items.size(), 1) * 3 * sizeof(Value));
+    }
+    items.push_back(std::move(value));
+}
+
+auto TypeName(const Value& value) noexcept -> std::string_view {
+    return std::visit(Overloaded{
+        [](const Nil&) -> std::string_view { return "nil"; },
+        [](double) -> std::string_view { return "number"; },
+        [](const StringPtr&) -> std::string_view { return "string"; },
+        [](const ListPtr&) -> std::string_view { return "list"; },
+        [](const Function&) -> std::string_view { return "function"; },
+        [](const Builtin&) -> std::string_view { return "function"; },
+        [](const Unset&) -> std::string_view { return "unset"; },
+    }, value);
+}
+
+bool IsTruthy(const Value& value) noexcept {
+    return std::visit(Overloaded{
+        [](const Nil&) { return false; },
+        [](double number) { return number != 0; },
+        [](const StringPtr& str) { return !str->IsEmpty(); },
+        [](const ListPtr& list) { return !list->IsEmpty(); },
+        [](const Unset&) { return false; },
+        [](const auto&) { return true; },
+    }, value);
+}
+
+bool ValuesEqual(const Value& lhs, const Value& rhs) {
+    if (lhs.index() != rhs.index()) {
+        return false;
+    }
+
+    return std::visit(Overloaded{
+        [](const Nil&, const Nil&) { return true; },
+        [](double a, double b) { return a == b; },
+        [](const StringPtr& a, const StringPtr& b) { return a == b || *a == *b; },
+        [](const ListPtr& a, const ListPtr& b) { return a == b || ListsEqual(*a, *b); },
+        [](const Function& a, const Function& b) { return a.proto == b.proto; },
+        [](const Builtin& a, const Builtin& b) { return a.function == b.function; },
+        [](const auto&, const auto&) { return false; },
+    }, lhs, rhs);
+}
+
+bool ListsEqual(const List& lhs, const List& rhs) {
+    if (lhs.GetSize() != rhs.GetSize()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.GetSize(); ++i) {
+        if (!ValuesEqual(lhs[i], rhs[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ValueLess(const Value& lhs, const Value& rhs) {
+    if (lhs.index() != rhs.index()) {
+        return lhs.index() < rhs.index();
+    }
+
+    return std::visit(Overloaded{
+        // NaN goes last; `<` alone is no strict weak order with it.
+        [](double a, double b) { return std::isnan(b) ? !std::isnan(a) : a < b; },
+        [](const StringPtr& a, const StringPtr& b) { return a->GetText() < b->GetText(); },
+        [](const ListPtr& a, const ListPtr& b) {
+            size_t size = std::min(a->GetSize(), b->GetSize());
+            for (size_t i = 0; i < size; ++i) {
+                if (ValueLess((*a)[i], (*b)[i])) {
+                    return true;
+                }
+                if (ValueLess((*b)[i], (*a)[i])) {
+                    return false;
+                }
+            }
+            return a->GetSize() < b->GetSize();
+        },
+        [](const Function& a, const Function& b) { return a.proto < b.proto; },
+        [](const Builtin& a, const Builtin& b) { return a.function < b.function; },
+        [](const auto&, const auto&) { return false; },
+    }, lhs, rhs);
+}
+
+void AppendNumber(std::pmr::string& out, double number) {
+    char buffer[32];
+    char* end;
+    if (number >= -kMaxExactInteger && number <= kMaxExactInteger && number == std::trunc(number)) {
+        end = std::to_chars(buffer, std::end(buffer), static_cast<int64_t>(number)).ptr;
+    } else {
+        end = std::to_chars(buffer, std::end(buffer), number).ptr;
+    }
+
+    out.append(buffer, end);
+}
+
+static void append_value(std::pmr::string& out, const Value& value, bool quote_strings) {
+    std::visit(Overloaded{
+        [&](const Nil&) { out += "nil"; },
+        [&](double number) { AppendNumber(out, number); },
+        [&](const StringPtr& str) {
+            if (quote_strings) {
+                out += '"';
+                out += str->GetText();
+                out += '"';
+            } else {
+                out += str->GetText();
+            }
+        },
+        [&](const ListPtr& list) {
+            out += '[';
+            for (size_t i = 0; i < list->GetSize(); ++i) {
+                if (i != 0) {
+                    out += ", ";
+                }
+                append_value(out, (*list)[i], true);
+            }
+            out += ']';
+        },
+        [&](const Function& function) {
+            out += "<function ";
+            out += function.proto->name;
+            out += '>';
+        },
+        [&](const Builtin& builtin) {
+            out += "<builtin ";
+            out += builtin.function->name;
+            out += '>';
+        },
+        [&](const Unset&) { out += "nil"; },
+    }, value);
+}
+
+void AppendValue(std::pmr::string& out, const Value& value) {
+    append_value(out, value, false);
+}
+
+void WriteValue(std::ostream& os, const Value& value) {
+    if (const auto* str = std::get_if<StringPtr>(&value)) {
+        os << (*str)->GetText();
+        return;
+    }
+
+    std::pmr::string text(GetMemoryResource());
+    AppendValue(text, value);
+    os << text;
+}
+
+auto ValueToString(const Value& value) -> std::pmr::string {
+    if (const auto* str = std::get_if<StringPtr>(&value)) {
+        return std::pmr::string((*str)->GetText(), GetMemoryResource());
+    }
+
+    std::pmr::string text(GetMemoryResource());
+    AppendValue(text, value);
+    return text;
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+struct FunctionProto;
+struct BuiltinFunction;
+class List;
+class String;
+
+template<class... Ts>
+struct Overloaded : Ts... {
+    using Ts::operator()...;
+};
+
+struct Nil {};
+
+// Marks a local slot that was not assigned yet; never leaves the VM.
+struct Unset {};
+
+struct Function {
+    const FunctionProto* proto;
+};
+
+struct Builtin {
+    const BuiltinFunction* function;
+};
+
+using StringPtr = std::shared_ptr<const String>;
+using ListPtr = std::shared_ptr<List>;
+
+using Value = std::variant<Nil, double, StringPtr, ListPtr, Function, Builtin, Unset>;
+
+// Immutable script string. Its hash, code point count and whether it is all
+// ASCII are worked out once at creation: len() and indexing of ASCII text
+// are O(1), and comparisons of different strings usually stop at the hash.
+// Script-visible positions count UTF-8 code points. A string may share a part
+// of another string's text instead of owning a copy, keeping that string
+// alive (see MakeStringPart).
+class String {
+public:
+    explicit String(std::pmr::string text) noexcept;
+    // `part` must lie in the text of `source`.
+    String(StringPtr source, std::string_view part) noexcept;
+
+    String(const String&) = delete;
+    String& operator=(const String&) = delete;
+
+    auto GetText() const noexcept -> std::string_view;
+    auto GetSize() const noexcept -> size_t;
+    auto GetLength() const noexcept -> size_t;
+    auto GetHash() const noexcept -> size_t;
+    bool IsAscii() const noexcept;
+    bool IsEmpty() const noexcept;
+
+    // Byte offset of code point `index`; GetSize() for GetLength().
+    auto GetOffset(size_t index) const noexcept -> size_t;
+    auto CharAt(size_t index) const -> Value;
+    // Code points [from, to).
+    auto Substr(size_t from, size_t to) const noexcept -> std::string_view;
+
+    friend bool operator==(const String& lhs, const String& rhs) noexcept;
+
+private:
+    std::pmr::string storage_;
+    StringPtr source_;
+    std::string_view text_;
+    size_t hash_;
+    size_t length_;
+    bool ascii_;
+};
+
+// Live bytes of the strings and lists owned by one script. While an account
+// is installed on the current thread (see ScopedMemoryAccount) MakeString and
+// MakeList charge it, and the values give their bytes back when destroyed.
+// List views are charged to the account of the storage they share.
+class MemoryAccount {
+public:
+    explicit MemoryAccount(size_t limit) noexcept;
+
+    // Throws ScriptError when the limit would be exceeded.
+    void Charge(size_t bytes);
+    // Throws like Charge if `bytes` more would not fit, but charges nothing.
+    void Check(size_t bytes) const;
+    void Credit(size_t bytes) noexcept;
+
+    auto GetUsage() const noexcept -> size_t;
+
+private:
+    std::atomic<size_t> usage_ = 0;
+    size_t limit_;
+};
+
+// Where MakeString and MakeList allocate on the current thread: the default
+// resource unless a ScopedMemoryResource is active. An interpreter installs
+// its own resource while it runs, so every value a script creates comes from
+// it and the embedder may release it wholesale once the interpreter and its
+// values are gone. A resource is only ever used by one thread at a time.
+auto GetMemoryResource() noexcept -> std::pmr::memory_resource*;
+
+class ScopedMemoryResource {
+public:
+    explicit ScopedMemoryResource(std::pmr::memory_resource* resource) noexcept;
+    ~ScopedMemoryResource();
+
+    ScopedMemoryResource(const ScopedMemoryResource&) = delete;
+    ScopedMemoryResource& operator=(const ScopedMemoryResource&) = delete;
+
+private:
+    std::pmr::memory_resource* previous_;
+};
+
+class ScopedMemoryAccount {
+public:
+    explicit ScopedMemoryAccount(std::shared_ptr<MemoryAccount> account) noexcept;
+    ~ScopedMemoryAccount();
+
+    ScopedMemoryAccount(const ScopedMemoryAccount&) = delete;
+    ScopedMemoryAccount& operator=(const ScopedMemoryAccount&) = delete;
+
+private:
+    std::shared_ptr<MemoryAccount> previous_;
+};
+
+// Items of one or more lists, charged to the account the first of them was
+// created under.
+struct ListStorage {
+    std::pmr::vector<Value> items;
+    std::shared_ptr<MemoryAccount> account;
+
+    ~ListStorage();
+
+    void Grow(size_t count);
+    void Shrink(size_t count) noexcept;
+};
+
+// Script list. Slices and repetitions are views sharing the storage of the
+// list they were made from, so they cost O(1) however long they are. The
+// first write through any list that does not own its storage outright copies
+// its items out, and the other lists never see the change.
+//
+// An owned list keeps its items at the end of the storage. Room in front of
+// them is only made once something is inserted near the front, so stacks stay
+// a plain vector while queues and deques get O(1) amortized work at both
+// ends; indexing is contiguous either way.
+class List {
+public:
+    explicit List(std::shared_ptr<ListStorage> storage) noexcept;
+    ~List();
+
+    auto GetSize() const noexcept -> size_t;
+    bool IsEmpty() const noexcept;
+    auto operator[](size_t index) const noexcept -> const Value&;
+
+    // Items [from, to), sharing this list's storage.
+    auto Slice(size_t from, size_t to) const -> ListPtr;
+    // This list's items cycled up to `size` items, sharing its storage.
+    auto Repeat(size_t size) const -> ListPtr;
+
+    void Set(size_t index, Value value);
+    void Push(Value value);
+    auto Pop() -> Value;
+    void Insert(size_t index, Value value);
+    auto Remove(size_t index) -> Value;
+    void Sort();
+
+private:
+    std::shared_ptr<ListStorage> storage_;
+    // Item i is storage_->items[offset_ + (phase_ + i) % period_]; views
+    // that do not wrap around keep phase_ at 0 so reads skip the modulo.
+    size_t offset_ = 0;
+    size_t period_ = 0;
+    size_t phase_ = 0;
+    size_t size_ = 0;
+
+    static constexpr size_t kMinFrontRoom = 8;
+
+    auto MakeView(size_t offset, size_t period, size_t phase, size_t size) const -> ListPtr;
+    bool IsRepeated() const noexcept;
+    // Makes this list the only user of a storage that ends with its items.
+    auto Own() -> std::pmr::vector<Value>&;
+    void ReserveFront(std::pmr::vector<Value>& items);
+};
+
+inline auto List::GetSize() const noexcept -> size_t {
+    return size_;
+}
+
+inline bool List::IsEmpty() const noexcept {
+    return size_ == 0;
+}
+
+inline auto List::operator[](size_t index) const noexcept -> const Value& {
+    if (phase_ + size_ > period_) {
+        return storage_->items[offset_ + (phase_ + index) % period_];
+    }
+    return storage_->items[offset_ + index];
+}
+
+class ScriptError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Raised inside worker interpreters when a callback tries to do something
+// observable; the parallel built-ins then fall back to sequential execution.
+class SideEffectError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Copies `text` into GetMemoryResource().
+auto MakeString(std::string_view text) -> Value;
+auto MakeString(const char* text) -> Value;
+// Takes the text over as is; build it on GetMemoryResource() to keep the
+// string in the script's resource.
+auto MakeString(std::pmr::string text) -> Value;
+// Shares `part` of the text of `source` rather than copying it, unless it is
+// too short for that to save an allocation. A shared part charges the
+// current account for the string object only, and keeps all of `source`
+// alive as long as it lives.
+auto MakeStringPart(const StringPtr& source, std::string_view part) -> Value;
+// One-byte strings are shared rather than allocated per call.
+auto MakeCharString(char c) -> Value;
+// Like MakeString, the items stay on whatever resource they were built on.
+auto MakeList(std::pmr::vector<Value> items) -> Value;
+
+// MakeString and MakeList charge a value once it is built, so code building
+// one checks the current account first: with the size when it is known up
+// front, or through AppendChecked before every reallocation.
+void CheckMemory(size_t bytes);
+void AppendChecked(std::pmr::vector<Value>& items, Value value);
+
+auto TypeName(const Value& value) noexcept -> std::string_view;
+bool IsTruthy(const Value& value) noexcept;
+bool ValuesEqual(const Value& lhs, const Value& rhs);
+bool ListsEqual(const List& lhs, const List& rhs);
+
+// Total order used by sort(): values of different types are ordered by type,
+// and NaN after every other number.
+bool ValueLess(const Value& lhs, const Value& rhs);
+
+// Shortest text that reads back as the same double; integral values up to
+// 2^53 take a fast path and print without a fraction ("3", not "3.0").
+void AppendNumber(std::pmr::string& out, double number);
+
+// print() representation: strings unquoted at the top level, quoted inside
+// lists. Backs WriteValue, ValueToString and to_string().
+void AppendValue(std::pmr::string& out, const Value& value);
+void WriteValue(std::ostream& os, const Value& value);
+auto ValueToString(const Value& value) -> std::pmr::string;
@@ -0,0 +1,158 @@
+#include "WorkStealingPool.h"
+
+#include <utility>
+
+static thread_local const WorkStealingPool* current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+WorkStealingPool::WorkStealingPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<TaskQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::Submit(Task task) {
+    size_t index = (current_pool == this ? current_worker : next_queue_++ % queues_.size());
+
+    bool waiting;
+    {
+        // Counted under the same lock as the push, so TryTake() cannot take
+        // the task and decrement queued_ before it was incremented.
+        std::lock_guard lock(mutex_);
+        {
+            std::lock_guard queue_lock(queues_[index]->mutex);
+            queues_[index]->tasks.push_back(std::move(task));
+        }
+        ++pending_;
+        ++queued_;
+        waiting = waiting_ > 0;
+    }
+    wake_.notify_one();
+    if (waiting) {
+        progress_.notify_all();
+    }
+}
+
+void WorkStealingPool::Wait() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this] { return pending_ == 0; });
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void WorkStealingPool::WaitFor(const std::atomic<size_t>& remaining) {
+    while (remaining.load() != 0) {
+        Task task;
+        if (TryTake(task)) {
+            Run(task);
+            continue;
+        }
+
+        // Tasks count `remaining` down before Run() takes mutex_, so no
+        // wake-up is missed.
+        std::unique_lock lock(mutex_);
+        ++waiting_;
+        progress_.wait(lock, [this, &remaining] { return remaining.load() == 0 || queued_ > 0; });
+        --waiting_;
+    }
+}
+
+auto WorkStealingPool::GetThreadCount() const noexcept -> size_t {
+    return workers_.size();
+}
+
+bool WorkStealingPool::TryPop(size_t index, Task& task) {
+    TaskQueue& queue = *queues_[index];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::TrySteal(size_t index, Task& task) {
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        TaskQueue& queue = *queues_[(index + offset) % queues_.size()];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool WorkStealingPool::TryTake(Task& task) {
+    size_t index = (current_pool == this ? current_worker : 0);
+    if (!TryPop(index, task) && !TrySteal(index, task)) {
+        return false;
+    }
+
+    std::lock_guard lock(mutex_);
+    --queued_;
+    return true;
+}
+
+void WorkStealingPool::WorkerLoop(size_t index) {
+    current_pool = this;
+    current_worker = index;
+
+    while (true) {
+        Task task;
+        if (TryTake(task)) {
+            Run(task);
+            continue;
+        }
+
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
+
+void WorkStealingPool::Run(Task& task) {
+    std::exception_ptr error;
+    try {
+        task();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard lock(mutex_);
+    if (error && !error_) {
+        error_ = error;
+    }
+    if (--pending_ == 0) {
+        idle_.notify_all();
+    }
+    if (waiting_ > 0) {
+        progress_.notify_all();
+    }
+}
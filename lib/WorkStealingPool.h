@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool with one task deque per worker. A worker pops its
+// own deque from the back and steals from the front of the others when idle.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t thread_count = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // An exception escaping a task is kept, and the first one is rethrown
+    // by the next Wait().
+    void Submit(Task task);
+
+    // Blocks until every submitted task has finished.
+    void Wait();
+
+    // Blocks until `remaining` drops to zero, running queued tasks meanwhile.
+    // Safe to call from a worker thread (e.g. a task waiting for its subtasks).
+    // The tasks must count `remaining` down even when they fail.
+    void WaitFor(const std::atomic<size_t>& remaining);
+
+    auto GetThreadCount() const noexcept -> size_t;
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    // Wakes WaitFor() callers when a task finishes or is queued.
+    std::condition_variable progress_;
+    size_t queued_ = 0;
+    size_t pending_ = 0;
+    size_t waiting_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+
+    std::atomic<size_t> next_queue_ = 0;
+
+    bool TryPop(size_t index, Task& task);
+    bool TrySteal(size_t index, Task& task);
+    bool TryTake(Task& task);
+    void WorkerLoop(size_t index);
+    void Run(Task& task);
+};
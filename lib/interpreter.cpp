@@ -1,5 +1,616 @@
 #include "interpreter.h"
 
-bool interpret(std::istream& input, std::ostream& output) {
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+#include "Builtins.h"
+#include "Compiler.h"
+#include "Operators.h"
+
+static constexpr size_t kMaxCallDepth = 100000;
+
+// Thrown by Block() to unwind out of a built-in that has to be retried.
+struct CallBlocked {};
+
+Interpreter::Interpreter(std::shared_ptr<const CompiledProgram> program, std::istream& input, std::ostream& output,
+                         std::pmr::memory_resource* resource)
+    : program_(std::move(program))
+    , resource_(resource)
+    , input_(input)
+    , input_reader_(input, resource)
+    , output_(output)
+    , output_buffer_(output, OutputBuffer::kDefaultThreshold, resource)
+    , globals_(resource)
+    , stack_(resource)
+    , frames_(resource)
+    , impure_functions_(resource) {
+    const SymbolTable& symbols = program_->GetSymbols();
+    globals_.resize(symbols.GetSize(), Unset{});
+    for (const auto& builtin : GetBuiltins()) {
+        if (auto symbol = symbols.Find(builtin.name)) {
+            globals_[*symbol] = Builtin{&builtin};
+        }
+    }
+}
+
+Interpreter::Interpreter(const Interpreter* parent, size_t workers)
+    : program_(parent->program_)
+    , resource_(std::pmr::get_default_resource())
+    , input_(parent->input_)
+    , input_reader_(parent->input_)
+    , output_(parent->output_)
+    , output_buffer_(parent->output_)
+    , globals_(parent->globals_.size(), Unset{})
+    , parent_(parent) {
+    // Callbacks on workers may not outrun, together, the budget the parent
+    // has left.
+    if (parent->instruction_budget_ != 0) {
+        size_t remaining = parent->instruction_budget_ - std::min(parent->instructions_, parent->instruction_budget_ - 1);
+        instruction_budget_ = std::max<size_t>(remaining / std::max<size_t>(workers, 1), 1);
+        ResetFuelLimit();
+    }
+}
+
+bool Interpreter::Run() {
+    Start();
+
+    ExecutionStatus status;
+    while ((status = Resume()) == ExecutionStatus::kBlocked) {
+        WaitUntilReady(io_wait_);
+    }
+
+    return status == ExecutionStatus::kFinished;
+}
+
+void Interpreter::Start() {
+    stack_.clear();
+    frames_.clear();
+    error_.clear();
+    instructions_ = 0;
+    if (profiler_ != nullptr) {
+        next_sample_ = sample_interval_;
+    }
+
+    frames_.push_back({&program_->GetMain(), 0, 0, 0});
+    status_ = ExecutionStatus::kSuspended;
+}
+
+auto Interpreter::Resume(size_t fuel) -> ExecutionStatus {
+    if (status_ != ExecutionStatus::kSuspended && status_ != ExecutionStatus::kBlocked) {
+        return status_;
+    }
+
+    slice_end_ = fuel > kUnlimitedFuel - instructions_ ? kUnlimitedFuel : instructions_ + fuel;
+    ResetFuelLimit();
+
+    ScopedMemoryAccount account(memory_);
+    ScopedMemoryResource resource(resource_);
+    try {
+        io_wait_ = {};
+        if (Execute(0)) {
+            status_ = ExecutionStatus::kFinished;
+        } else {
+            status_ = io_wait_.fd != -1 ? ExecutionStatus::kBlocked : ExecutionStatus::kSuspended;
+        }
+        output_buffer_.Flush();
+        return status_;
+    } catch (const ScriptError& e) {
+        error_ = FormatError(e.what());
+    } catch (const std::bad_alloc&) {
+        error_ = FormatError("out of memory");
+    } catch (const std::length_error&) {
+        error_ = FormatError("out of memory");
+    }
+
+    native_calls_ = 0;
+    output_buffer_.Flush();
+    status_ = ExecutionStatus::kFailed;
+    return status_;
+}
+
+void Interpreter::SetInstructionBudget(size_t instructions) noexcept {
+    instruction_budget_ = instructions;
+    ResetFuelLimit();
+}
+
+void Interpreter::SetMemoryBudget(size_t bytes) {
+    memory_ = bytes == 0 ? nullptr : std::make_shared<MemoryAccount>(bytes);
+}
+
+void Interpreter::SetProfiler(Profiler* profiler, size_t interval) noexcept {
+    profiler_ = profiler;
+    sample_interval_ = std::max<size_t>(interval, 1);
+    next_sample_ = profiler != nullptr ? sample_interval_ : kUnlimitedFuel;
+    ResetFuelLimit();
+}
+
+auto Interpreter::GetInstructionCount() const noexcept -> size_t {
+    return instructions_;
+}
+
+auto Interpreter::GetMemoryUsage() const noexcept -> size_t {
+    return memory_ ? memory_->GetUsage() : 0;
+}
+
+auto Interpreter::GetMemoryAccount() const noexcept -> const std::shared_ptr<MemoryAccount>& {
+    return memory_;
+}
+
+void Interpreter::AddInstructions(size_t count) noexcept {
+    instructions_ += count;
+}
+
+void Interpreter::AwaitInput(bool until_end) {
+    // Prompts printed before read() must reach the reader first.
+    output_buffer_.Flush();
+    output_.flush();
+
+    auto* input = dynamic_cast<AsyncInput*>(input_.rdbuf());
+    if (input == nullptr || (!until_end && input_reader_.HasBufferedLine())) {
+        return;
+    }
+
+    auto ready = [input, until_end] { return until_end ? input->IsComplete() : input->HasLine(); };
+    if (!ready()) {
+        input->Fill();
+    }
+    if (ready()) {
+        return;
+    }
+
+    if (native_calls_ != 0) {
+        until_end ? input->WaitForEnd() : input->WaitForLine();
+        return;
+    }
+    Block({input->GetFd(), false});
+}
+
+void Interpreter::AwaitOutput() {
+    auto* output = dynamic_cast<AsyncOutput*>(output_.rdbuf());
+    if (output == nullptr || !output->IsCongested()) {
+        return;
+    }
+
+    output->Flush();
+    if (output->IsCongested()) {
+        if (native_calls_ != 0) {
+            output->Drain();
+            return;
+        }
+        Block({output->GetFd(), true});
+    }
+}
+
+auto Interpreter::GetIoWait() const noexcept -> const IoWait& {
+    return io_wait_;
+}
+
+void Interpreter::Block(IoWait wait) {
+    io_wait_ = wait;
+    throw CallBlocked{};
+}
+
+auto Interpreter::GetError() const noexcept -> const std::string& {
+    return error_;
+}
+
+auto Interpreter::GetInput() noexcept -> std::istream& {
+    return input_;
+}
+
+auto Interpreter::GetInputReader() noexcept -> InputReader& {
+    return input_reader_;
+}
+
+auto Interpreter::GetOutput() noexcept -> std::ostream& {
+    return output_;
+}
+
+auto Interpreter::GetOutputBuffer() noexcept -> OutputBuffer& {
+    return output_buffer_;
+}
+
+auto Interpreter::GetRandom() -> std::mt19937& {
+    if (!random_) {
+        random_.emplace(std::random_device{}());
+    }
+
+    return *random_;
+}
+
+auto Interpreter::GetStackTrace() const -> std::vector<std::string> {
+    std::vector<std::string> trace;
+    for (auto it = frames_.rbegin(); it != frames_.rend(); ++it) {
+        std::ostringstream os;
+        size_t ip = it->ip == 0 ? 0 : it->ip - 1;
+        os << it->proto->name << " (line " << it->proto->rows[ip] + 1 << ")";
+        trace.push_back(os.str());
+    }
+
+    return trace;
+}
+
+void Interpreter::SetWorkerPool(WorkStealingPool* pool) noexcept {
+    pool_ = pool;
+}
+
+auto Interpreter::GetWorkerPool() const noexcept -> WorkStealingPool* {
+    return pool_;
+}
+
+auto Interpreter::CallFunction(const Value& callee, std::span<const Value> args) -> Value {
+    size_t depth = frames_.size();
+    stack_.push_back(callee);
+    stack_.insert(stack_.end(), args.begin(), args.end());
+
+    CallValue(args.size());
+    if (frames_.size() != depth) {
+        ++native_calls_;
+        Execute(depth);
+        --native_calls_;
+        ResetFuelLimit();
+    }
+
+    return Pop();
+}
+
+auto Interpreter::MakeWorker(size_t workers) const -> Interpreter {
+    return Interpreter(this, workers);
+}
+
+bool Interpreter::IsWorker() const noexcept {
+    return parent_ != nullptr;
+}
+
+void Interpreter::CheckSideEffect(std::string_view operation) const {
+    if (IsWorker()) {
+        throw SideEffectError(std::string(operation));
+    }
+}
+
+bool Interpreter::IsKnownImpure(const FunctionProto* proto) const {
+    return impure_functions_.contains(proto);
+}
+
+void Interpreter::MarkImpure(const FunctionProto* proto) {
+    impure_functions_.insert(proto);
+}
+
+auto Interpreter::FindGlobal(uint32_t symbol) const noexcept -> const Value* {
+    const Value& global = globals_[symbol];
+    if (!std::holds_alternative<Unset>(global)) {
+        return &global;
+    }
+
+    return parent_ != nullptr ? parent_->FindGlobal(symbol) : nullptr;
+}
+
+void Interpreter::UndefinedGlobal(uint32_t symbol) const {
+    throw ScriptError("undefined variable '" + program_->GetSymbols().GetName(symbol) + "'");
+}
+
+auto Interpreter::Pop() -> Value {
+    Value value = std::move(stack_.back());
+    stack_.pop_back();
+    return value;
+}
+
+auto Interpreter::FormatError(const std::string& message) const -> std::string {
+    std::ostringstream os;
+    os << "runtime error: " << message;
+    for (const auto& frame : GetStackTrace()) {
+        os << "\n    in " << frame;
+    }
+
+    return os.str();
+}
+
+// Called once instructions_ reaches fuel_limit_, which also stops at the
+// next profiler sample. Throws when the budget is spent; otherwise reports
+// whether execution may suspend here, which is only possible when no native
+// code is waiting for a result further up the stack.
+bool Interpreter::OutOfFuel() {
+    if (instructions_ >= next_sample_) {
+        TakeSample();
+        ResetFuelLimit();
+        if (instructions_ < fuel_limit_) {
+            return false;
+        }
+    }
+    if (instruction_budget_ != 0 && instructions_ >= instruction_budget_) {
+        throw ScriptError("instruction budget of " + std::to_string(instruction_budget_) + " exceeded");
+    }
+    if (native_calls_ == 0) {
+        return true;
+    }
+
+    fuel_limit_ = std::min(instruction_budget_ != 0 ? instruction_budget_ : kUnlimitedFuel, next_sample_);
     return false;
-}
\ No newline at end of file
+}
+
+void Interpreter::ResetFuelLimit() noexcept {
+    fuel_limit_ = instruction_budget_ != 0 ? std::min(slice_end_, instruction_budget_) : slice_end_;
+    fuel_limit_ = std::min(fuel_limit_, next_sample_);
+}
+
+void Interpreter::TakeSample() {
+    sample_stack_.clear();
+    for (size_t i = 0; i < frames_.size(); ++i) {
+        // The innermost frame is about to run code[ip]; the others wait in
+        // the call at code[ip - 1].
+        size_t ip = i + 1 == frames_.size() ? frames_[i].ip : frames_[i].ip - 1;
+        sample_stack_.push_back({frames_[i].proto, ip});
+    }
+    profiler_->Record(sample_stack_);
+
+    // xorshift32: a gap anywhere in [interval / 2, interval * 3 / 2).
+    sample_jitter_ ^= sample_jitter_ << 13;
+    sample_jitter_ ^= sample_jitter_ >> 17;
+    sample_jitter_ ^= sample_jitter_ << 5;
+    next_sample_ = instructions_ + sample_interval_ / 2 + sample_jitter_ % sample_interval_ + 1;
+}
+
+void Interpreter::CallValue(size_t argc) {
+    size_t callee_index = stack_.size() - argc - 1;
+    const Value& callee = stack_[callee_index];
+
+    if (const auto* function = std::get_if<Function>(&callee)) {
+        const FunctionProto* proto = function->proto;
+        if (argc != proto->arity) {
+            throw ScriptError("function " + proto->name + " expects " + std::to_string(proto->arity) +
+                              " arguments, got " + std::to_string(argc));
+        }
+        if (frames_.size() >= kMaxCallDepth) {
+            throw ScriptError("stack overflow");
+        }
+
+        stack_.resize(stack_.size() + proto->local_count - proto->arity, Unset{});
+        frames_.push_back({proto, 0, callee_index + 1, callee_index});
+        return;
+    }
+
+    if (const auto* builtin = std::get_if<Builtin>(&callee)) {
+        const BuiltinFunction& function = *builtin->function;
+        if (argc < function.min_args || argc > function.max_args) {
+            throw ScriptError(std::string(function.name) + "() got a wrong number of arguments: " + std::to_string(argc));
+        }
+
+        Value result = function.impl(*this, std::span<const Value>(stack_.data() + callee_index + 1, argc));
+        stack_.resize(callee_index);
+        stack_.push_back(std::move(result));
+        return;
+    }
+
+    throw ScriptError("attempt to call a " + std::string(TypeName(callee)) + " value");
+}
+
+bool Interpreter::Execute(size_t stop_depth) {
+    while (true) {
+        if (instructions_ >= fuel_limit_ && OutOfFuel()) {
+            return false;
+        }
+        ++instructions_;
+
+        CallFrame& frame = frames_.back();
+        const Instruction& instruction = frame.proto->code[frame.ip++];
+
+        switch (instruction.op) {
+            case OpCode::kConst:
+                stack_.push_back(frame.proto->constants[instruction.a]);
+                break;
+            case OpCode::kNil:
+                stack_.emplace_back(Nil{});
+                break;
+            case OpCode::kPop:
+                stack_.pop_back();
+                break;
+            case OpCode::kDup2: {
+                size_t size = stack_.size();
+                stack_.push_back(stack_[size - 2]);
+                stack_.push_back(stack_[size - 1]);
+                break;
+            }
+
+            case OpCode::kGetGlobal: {
+                const Value& global = globals_[instruction.a];
+                if (!std::holds_alternative<Unset>(global)) {
+                    stack_.push_back(global);
+                    break;
+                }
+                const Value* inherited = FindGlobal(instruction.a);
+                if (inherited == nullptr) {
+                    UndefinedGlobal(instruction.a);
+                }
+                stack_.push_back(*inherited);
+                break;
+            }
+            case OpCode::kSetGlobal:
+                CheckSideEffect("global assignment");
+                globals_[instruction.a] = stack_.back();
+                break;
+            case OpCode::kGetLocal:
+                stack_.push_back(stack_[frame.base + instruction.a]);
+                break;
+            case OpCode::kSetLocal:
+                stack_[frame.base + instruction.a] = stack_.back();
+                break;
+            case OpCode::kGetName: {
+                const Value& local = stack_[frame.base + instruction.a];
+                if (!std::holds_alternative<Unset>(local)) {
+                    stack_.push_back(local);
+                    break;
+                }
+                const Value* global = FindGlobal(instruction.b);
+                if (global == nullptr) {
+                    UndefinedGlobal(instruction.b);
+                }
+                stack_.push_back(*global);
+                break;
+            }
+            case OpCode::kSetName: {
+                Value& local = stack_[frame.base + instruction.a];
+                if (std::holds_alternative<Unset>(local)) {
+                    if (IsWorker() && FindGlobal(instruction.b) != nullptr) {
+                        CheckSideEffect("global assignment");
+                    }
+                    if (Value& global = globals_[instruction.b]; !std::holds_alternative<Unset>(global)) {
+                        global = stack_.back();
+                        break;
+                    }
+                }
+                local = stack_.back();
+                break;
+            }
+
+            case OpCode::kAdd:
+            case OpCode::kSub:
+            case OpCode::kMul:
+            case OpCode::kDiv:
+            case OpCode::kMod:
+            case OpCode::kPow:
+            case OpCode::kEq:
+            case OpCode::kNe:
+            case OpCode::kLt:
+            case OpCode::kGt:
+            case OpCode::kLe:
+            case OpCode::kGe: {
+                Value rhs = Pop();
+                stack_.back() = BinaryOperation(instruction.op, stack_.back(), rhs);
+                break;
+            }
+
+            case OpCode::kNeg:
+            case OpCode::kPlus:
+            case OpCode::kNot:
+                stack_.back() = UnaryOperation(instruction.op, stack_.back());
+                break;
+
+            case OpCode::kJump:
+                frame.ip = instruction.a;
+                break;
+            case OpCode::kJumpIfFalse:
+                if (!IsTruthy(Pop())) {
+                    frame.ip = instruction.a;
+                }
+                break;
+            case OpCode::kJumpIfFalseKeep:
+                if (!IsTruthy(stack_.back())) {
+                    frame.ip = instruction.a;
+                }
+                break;
+            case OpCode::kJumpIfTrueKeep:
+                if (IsTruthy(stack_.back())) {
+                    frame.ip = instruction.a;
+                }
+                break;
+
+            case OpCode::kCall:
+                try {
+                    CallValue(instruction.a);
+                } catch (const CallBlocked&) {
+                    // Nothing was popped yet; run the call again on resume.
+                    --frames_.back().ip;
+                    --instructions_;
+                    return false;
+                }
+                break;
+            case OpCode::kReturn: {
+                Value result = Pop();
+                stack_.resize(frame.return_to);
+                frames_.pop_back();
+                stack_.push_back(std::move(result));
+                if (frames_.size() == stop_depth) {
+                    return true;
+                }
+                break;
+            }
+
+            case OpCode::kMakeList: {
+                std::pmr::vector<Value> items(std::make_move_iterator(stack_.end() - instruction.a),
+                                              std::make_move_iterator(stack_.end()), resource_);
+                stack_.resize(stack_.size() - instruction.a);
+                stack_.push_back(MakeList(std::move(items)));
+                break;
+            }
+            case OpCode::kIndex: {
+                Value index = Pop();
+                stack_.back() = IndexValue(stack_.back(), index);
+                break;
+            }
+            case OpCode::kSlice: {
+                Value end = (instruction.a & kSliceHasEnd) ? Pop() : Value(Nil{});
+                Value begin = (instruction.a & kSliceHasBegin) ? Pop() : Value(Nil{});
+                stack_.back() = SliceValue(stack_.back(),
+                                           (instruction.a & kSliceHasBegin) ? &begin : nullptr,
+                                           (instruction.a & kSliceHasEnd) ? &end : nullptr);
+                break;
+            }
+            case OpCode::kSetIndex: {
+                CheckSideEffect("list assignment");
+                Value value = Pop();
+                Value index = Pop();
+                SetIndexValue(stack_.back(), index, value);
+                stack_.back() = std::move(value);
+                break;
+            }
+
+            case OpCode::kIterInit: {
+                const Value& sequence = stack_.back();
+                if (!std::holds_alternative<ListPtr>(sequence) && !std::holds_alternative<StringPtr>(sequence)) {
+                    throw ScriptError("cannot iterate over a " + std::string(TypeName(sequence)));
+                }
+                stack_.emplace_back(0.0);
+                break;
+            }
+            case OpCode::kIterNext: {
+                double& position = std::get<double>(stack_.back());
+                const Value& sequence = stack_[stack_.size() - 2];
+                auto index = static_cast<size_t>(position);
+
+                Value element;
+                if (const auto* list = std::get_if<ListPtr>(&sequence)) {
+                    if (index >= (*list)->GetSize()) {
+                        frame.ip = instruction.a;
+                        break;
+                    }
+                    element = (**list)[index];
+                } else {
+                    // For strings the position is a byte offset, so walking
+                    // UTF-8 text stays linear.
+                    const auto& str = std::get<StringPtr>(sequence)->GetText();
+                    if (index >= str.size()) {
+                        frame.ip = instruction.a;
+                        break;
+                    }
+                    size_t end = index + 1;
+                    while (end < str.size() && (static_cast<unsigned char>(str[end]) & 0xC0) == 0x80) {
+                        ++end;
+                    }
+                    element = end == index + 1 ? MakeCharString(str[index]) : MakeString(std::string_view(str).substr(index, end - index));
+                    position = static_cast<double>(end);
+                    stack_.push_back(std::move(element));
+                    break;
+                }
+
+                position += 1;
+                stack_.push_back(std::move(element));
+                break;
+            }
+        }
+    }
+}
+
+bool interpret(std::istream& input, std::ostream& output) {
+    std::string code{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+
+    std::shared_ptr<const CompiledProgram> program;
+    try {
+        program = CompiledProgram::Compile(code);
+    } catch (const SyntaxError&) {
+        return false;
+    }
+
+    Interpreter interpreter(program, input, output);
+    return interpreter.Run();
+}
@@ -1,3 +1,174 @@
+#pragma once
+
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "AsyncIo.h"
+#include "Bytecode.h"
+#include "InputReader.h"
+#include "OutputBuffer.h"
+#include "Profiler.h"
+#include "Value.h"
+
+class WorkStealingPool;
+
+enum class ExecutionStatus {
+    kFinished,
+    kSuspended,
+    // Waiting for a descriptor, see GetIoWait().
+    kBlocked,
+    kFailed,
+};
+
+// Executes a CompiledProgram. Every instance owns its globals, value stack
+// and I/O streams, so independent instances may run on different threads
+// while sharing the same program.
+//
+// The interpreter's containers and every value its script creates are
+// allocated from `resource`, which must outlive the interpreter. It is only
+// used by whichever thread is running the script; callbacks of the parallel
+// built-ins allocate from the default resource instead.
+class Interpreter {
+public:
+    Interpreter(std::shared_ptr<const CompiledProgram> program, std::istream& input, std::ostream& output,
+                std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    static constexpr size_t kUnlimitedFuel = static_cast<size_t>(-1);
+
+    bool Run();
+
+    // Resumable execution: Start() sets up the main frame, then every
+    // Resume(fuel) runs at most `fuel` instructions and returns kSuspended if
+    // the script is not done yet. Instructions executed by native callbacks
+    // (e.g. a function passed to sort) cannot be interrupted, so a slice may
+    // overrun until control is back in script code.
+    void Start();
+    auto Resume(size_t fuel = kUnlimitedFuel) -> ExecutionStatus;
+
+    // Per-script budgets, zero meaning unlimited. Running out of either fails
+    // the script with a runtime error.
+    void SetInstructionBudget(size_t instructions) noexcept;
+    void SetMemoryBudget(size_t bytes);
+    auto GetInstructionCount() const noexcept -> size_t;
+    auto GetMemoryUsage() const noexcept -> size_t;
+    // Null without a memory budget.
+    auto GetMemoryAccount() const noexcept -> const std::shared_ptr<MemoryAccount>&;
+    // Counts instructions run elsewhere on the script's behalf, e.g. by
+    // workers; the budget check fires at the next instruction.
+    void AddInstructions(size_t count) noexcept;
+
+    // Records the call stack into `profiler` about every `interval`
+    // instructions; the gaps are jittered so that loops do not alias with
+    // the interval. Sampling rides on the fuel check, so an interpreter
+    // without a profiler pays nothing for it. Set before Start().
+    void SetProfiler(Profiler* profiler, size_t interval = Profiler::kDefaultInterval) noexcept;
+
+    // I/O built-ins call these before touching the streams. When a stream is
+    // an AsyncInput/AsyncOutput that is not ready, the script is suspended as
+    // kBlocked and the built-in call is repeated on the next Resume(); inside
+    // native callbacks, where that is impossible, they wait instead.
+    // AwaitInput(true) waits for the whole remaining input.
+    void AwaitInput(bool until_end = false);
+    void AwaitOutput();
+    auto GetIoWait() const noexcept -> const IoWait&;
+
+    auto GetError() const noexcept -> const std::string&;
+
+    auto GetInput() noexcept -> std::istream&;
+    // read(), read_lines() and read_all() go through this reader rather than
+    // GetInput().
+    auto GetInputReader() noexcept -> InputReader&;
+    auto GetOutput() noexcept -> std::ostream&;
+    // print()/println() go through this buffer rather than GetOutput().
+    auto GetOutputBuffer() noexcept -> OutputBuffer&;
+    auto GetRandom() -> std::mt19937&;
+    auto GetStackTrace() const -> std::vector<std::string>;
+
+    // Pool used by the parallel built-ins (pmap, pfilter, preduce). Without
+    // one they run sequentially.
+    void SetWorkerPool(WorkStealingPool* pool) noexcept;
+    auto GetWorkerPool() const noexcept -> WorkStealingPool*;
+
+    // Calls a script or built-in function from native code. May reallocate
+    // the value stack, so callers must not keep spans into it across the call.
+    auto CallFunction(const Value& callee, std::span<const Value> args) -> Value;
+
+    // Worker interpreters run pure callbacks of the parallel built-ins. They
+    // read the parent's globals and reject any observable side effect. The
+    // parent's remaining instruction budget is split evenly among `workers`.
+    auto MakeWorker(size_t workers = 1) const -> Interpreter;
+    bool IsWorker() const noexcept;
+    void CheckSideEffect(std::string_view operation) const;
+
+    bool IsKnownImpure(const FunctionProto* proto) const;
+    void MarkImpure(const FunctionProto* proto);
+
+private:
+    struct CallFrame {
+        const FunctionProto* proto;
+        size_t ip;
+        size_t base;
+        size_t return_to;
+    };
+
+    std::shared_ptr<const CompiledProgram> program_;
+    std::pmr::memory_resource* resource_;
+    std::istream& input_;
+    InputReader input_reader_;
+    std::ostream& output_;
+    OutputBuffer output_buffer_;
+
+    // Indexed by the program's symbol ids; Unset marks an undefined global.
+    std::pmr::vector<Value> globals_;
+    std::pmr::vector<Value> stack_;
+    std::pmr::vector<CallFrame> frames_;
+    std::optional<std::mt19937> random_;
+
+    const Interpreter* parent_ = nullptr;
+    WorkStealingPool* pool_ = nullptr;
+    std::pmr::unordered_set<const FunctionProto*> impure_functions_;
+
+    size_t instructions_ = 0;
+    size_t instruction_budget_ = 0;
+    size_t slice_end_ = kUnlimitedFuel;
+    size_t fuel_limit_ = kUnlimitedFuel;
+    size_t native_calls_ = 0;
+    std::shared_ptr<MemoryAccount> memory_;
+    IoWait io_wait_;
+
+    Profiler* profiler_ = nullptr;
+    size_t sample_interval_ = 0;
+    size_t next_sample_ = kUnlimitedFuel;
+    uint32_t sample_jitter_ = 1;
+    std::vector<Profiler::Frame> sample_stack_;
+
+    ExecutionStatus status_ = ExecutionStatus::kFinished;
+    std::string error_;
+
+    Interpreter(const Interpreter* parent, size_t workers);
+
+    auto FindGlobal(uint32_t symbol) const noexcept -> const Value*;
+    [[noreturn]] void UndefinedGlobal(uint32_t symbol) const;
+    // Returns false when the current slice ran out of fuel or the script
+    // blocked on I/O.
+    bool Execute(size_t stop_depth);
+    bool OutOfFuel();
+    void ResetFuelLimit() noexcept;
+    void TakeSample();
+    void Block(IoWait wait);
+    void CallValue(size_t argc);
+
+    auto Pop() -> Value;
+    auto FormatError(const std::string& message) const -> std::string;
+};
 
-bool interpret(std::istream& input, std::ostream& output);
\ No newline at end of file
+bool interpret(std::istream& input, std::ostream& output);
@@ -0,0 +1,114 @@
+#include <lib/AsyncIo.h>
+#include <lib/Bytecode.h>
+#include <lib/Scheduler.h>
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+
+#include <future>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+struct Pipe {
+    int read_fd = -1;
+    int write_fd = -1;
+
+    Pipe() {
+        int fds[2];
+        EXPECT_EQ(pipe(fds), 0);
+        read_fd = fds[0];
+        write_fd = fds[1];
+    }
+
+    ~Pipe() {
+        CloseWrite();
+        close(read_fd);
+    }
+
+    void CloseWrite() {
+        if (write_fd != -1) {
+            close(write_fd);
+            write_fd = -1;
+        }
+    }
+};
+
+TEST(AsyncIoTestSuite, RunWaitsForInput) {
+    Pipe pipe;
+    AsyncInput buffer(pipe.read_fd);
+    std::istream input(&buffer);
+    std::ostringstream output;
+
+    std::thread writer([&pipe] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT_EQ(write(pipe.write_fd, "first\nsec", 9), 9);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT_EQ(write(pipe.write_fd, "ond\n", 4), 4);
+        pipe.CloseWrite();
+    });
+
+    Interpreter interpreter(CompiledProgram::Compile("println(read())\nprintln(read())\nprintln(read())"), input, output);
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    writer.join();
+
+    ASSERT_EQ(output.str(), "first\nsecond\nnil\n");
+}
+
+TEST(AsyncIoTestSuite, BlockedReadYieldsThread) {
+    Pipe pipe;
+    AsyncInput buffer(pipe.read_fd);
+    std::istream input(&buffer);
+    std::istringstream no_input;
+    std::ostringstream reader_output;
+    std::ostringstream worker_output;
+    std::promise<void> worker_done;
+
+    Scheduler scheduler(1);
+    scheduler.Spawn(CompiledProgram::Compile("println(read() + \"!\")"), input, reader_output, {}, nullptr);
+    scheduler.Spawn(CompiledProgram::Compile("println(len(range(1000)))"), no_input, worker_output, {},
+                    [&worker_done](const ScriptOutcome&) { worker_done.set_value(); });
+
+    ASSERT_EQ(worker_done.get_future().wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    ASSERT_EQ(write(pipe.write_fd, "hello\n", 6), 6);
+    scheduler.Wait();
+
+    ASSERT_EQ(worker_output.str(), "1000\n");
+    ASSERT_EQ(reader_output.str(), "hello!\n");
+}
+
+TEST(AsyncIoTestSuite, SlowReaderYieldsThread) {
+    Pipe pipe;
+    std::istringstream no_input;
+    std::ostringstream worker_output;
+    std::promise<void> worker_done;
+    ScriptOutcome writer_outcome;
+
+    {
+        AsyncOutput buffer(pipe.write_fd, 1024);
+        std::ostream output(&buffer);
+
+        Scheduler scheduler(1);
+        scheduler.Spawn(CompiledProgram::Compile("for i in range(100000) println(\"line\") end for"), no_input, output,
+                        {}, [&writer_outcome](const ScriptOutcome& outcome) { writer_outcome = outcome; });
+        scheduler.Spawn(CompiledProgram::Compile("println(len(range(1000)))"), no_input, worker_output, {},
+                        [&worker_done](const ScriptOutcome&) { worker_done.set_value(); });
+
+        ASSERT_EQ(worker_done.get_future().wait_for(std::chrono::seconds(10)), std::future_status::ready);
+
+        std::thread reader([&pipe] {
+            char chunk[4096];
+            size_t total = 0;
+            ssize_t count;
+            while (total < 500000 && (count = read(pipe.read_fd, chunk, sizeof(chunk))) > 0) {
+                total += static_cast<size_t>(count);
+            }
+            EXPECT_EQ(total, 500000);
+        });
+        scheduler.Wait();
+        reader.join();
+    }
+
+    ASSERT_TRUE(writer_outcome.success) << writer_outcome.error;
+    ASSERT_EQ(worker_output.str(), "1000\n");
+}
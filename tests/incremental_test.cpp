@@ -0,0 +1,164 @@
+#include <lib/IncrementalCompiler.h>
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+
+static auto row_offset(const std::string& code, size_t row) -> size_t {
+    size_t offset = 0;
+    for (; row > 0; --row) {
+        offset = code.find('\n', offset);
+        if (offset == std::string::npos) {
+            return code.size();
+        }
+        ++offset;
+    }
+    return offset;
+}
+
+static auto random_lines(std::mt19937& random, const std::vector<std::string>& pool, bool trailing_newline) -> std::string {
+    std::string text;
+    size_t count = random() % 4;
+    for (size_t i = 0; i < count; ++i) {
+        text += pool[random() % pool.size()];
+        if (i + 1 < count || trailing_newline) {
+            text += '\n';
+        }
+    }
+    return text;
+}
+
+static void expect_same_tokens(const Lexer& lexer, const std::string& code) {
+    Lexer expected;
+    expected.LoadCode(code);
+    expected.Parse();
+
+    ASSERT_EQ(lexer.GetCode(), code);
+    ASSERT_EQ(lexer.GetRowCount(), std::count(code.begin(), code.end(), '\n') + 1);
+    const auto& tokens = lexer.GetTokens();
+    const auto& expected_tokens = expected.GetTokens();
+    ASSERT_EQ(tokens.size(), expected_tokens.size()) << code;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        ASSERT_EQ(tokens[i].type, expected_tokens[i].type) << i;
+        ASSERT_EQ(tokens[i].text, expected_tokens[i].text) << i;
+        ASSERT_EQ(tokens[i].place.row, expected_tokens[i].place.row) << i;
+        ASSERT_EQ(tokens[i].place.column, expected_tokens[i].place.column) << i;
+    }
+}
+
+TEST(IncrementalTestSuite, LexerEditsMatchFullParse) {
+    const std::vector<std::string> pool = {
+        "x = 1", "y = x + 2.5e3", "s = \"a b\"", "s = \"open", "close\" + s", "\"", "// comment \"",
+        "print(\"\\\"q\\\"\")", "", "  if x then", "end if", "l = [1, 2][0:1]", "\"\\", "z //",
+    };
+
+    std::mt19937 random(17);
+    std::string code = "x = 1\ns = \"two\nlines\"\ny = 2\n";
+    Lexer lexer;
+    lexer.LoadCode(code);
+    lexer.Parse();
+
+    for (int step = 0; step < 1000; ++step) {
+        size_t rows = lexer.GetRowCount();
+        size_t first = random() % (rows + 1);
+        size_t last = std::min(rows, first + random() % 3);
+        std::string text = random_lines(random, pool, random() % 4 != 0);
+
+        size_t begin = row_offset(code, first);
+        code.replace(begin, row_offset(code, last) - begin, text);
+        lexer.Edit(first, last, text);
+
+        expect_same_tokens(lexer, code);
+        if (HasFatalFailure()) {
+            return;
+        }
+    }
+}
+
+TEST(IncrementalTestSuite, EditsMatchFullCompile) {
+    const std::vector<std::string> pool = {
+        "x = 1", "y = x + 2", "if x > 1 then", "else", "end if", "for i in range(3)", "end for",
+        "f = function(a)", "return a * 2", "end function", "println(f(x))", "l = [x, \"s\"][0:1]",
+        "s = \"open", "close\"", "x += 1", "(x)", "",
+    };
+
+    std::mt19937 random(29);
+    std::string code = "x = 1\nf = function(a)\nreturn a + 1\nend function\nprintln(f(x))\n";
+    IncrementalCompiler compiler(code);
+
+    for (int step = 0; step < 600; ++step) {
+        size_t rows = compiler.GetLexer().GetRowCount();
+        size_t first = random() % (rows + 1);
+        size_t last = std::min(rows, first + random() % 3);
+        std::string text = random_lines(random, pool, true);
+
+        size_t begin = row_offset(code, first);
+        code.replace(begin, row_offset(code, last) - begin, text);
+        compiler.Edit(first, last, text);
+
+        std::shared_ptr<const CompiledProgram> expected;
+        try {
+            expected = CompiledProgram::Compile(code);
+        } catch (const SyntaxError& e) {
+            auto errors = compiler.GetErrors();
+            ASSERT_FALSE(errors.empty()) << code;
+            ASSERT_STREQ(errors.front().what(), e.what()) << code;
+            continue;
+        }
+
+        ASSERT_TRUE(compiler.GetErrors().empty()) << code;
+        const FunctionProto& main = compiler.GetProgram()->GetMain();
+        const FunctionProto& expected_main = expected->GetMain();
+        ASSERT_EQ(main.code.size(), expected_main.code.size()) << code;
+        for (size_t i = 0; i < main.code.size(); ++i) {
+            ASSERT_EQ(main.code[i].op, expected_main.code[i].op) << code;
+            ASSERT_EQ(main.rows[i], expected_main.rows[i]) << code;
+            ASSERT_EQ(main.columns[i], expected_main.columns[i]) << code;
+        }
+        ASSERT_EQ(main.constants.size(), expected_main.constants.size()) << code;
+    }
+}
+
+TEST(IncrementalTestSuite, ReusesUnaffectedStatements) {
+    std::string code = "f = function(n)\n    if n < 2 then return n end if\n    return f(n - 1) + f(n - 2)\nend function\n";
+    for (int i = 0; i < 1000; ++i) {
+        code += "v" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+    }
+    code += "for i in range(3)\n    v1 += i\nend for\nprintln(f(10) + v500 + v1)\n";
+
+    IncrementalCompiler compiler(code);
+    ASSERT_EQ(compiler.GetStatementCount(), 1003);
+
+    compiler.Edit(504, 505, "v500 = 1000\n");
+    ASSERT_LE(compiler.GetCompiledCount(), 2);
+    compiler.Edit(4, 4, "// two new\n// rows\n");
+    ASSERT_LE(compiler.GetCompiledCount(), 1);
+    ASSERT_EQ(compiler.GetStatementCount(), 1003);
+
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(compiler.GetProgram(), input, output);
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(output.str(), "1059\n");
+}
+
+TEST(IncrementalTestSuite, SyntaxErrorsFollowEdits) {
+    IncrementalCompiler compiler("x = 1\ny = )\nprintln(x)\n");
+    auto errors = compiler.GetErrors();
+    ASSERT_EQ(errors.size(), 1);
+    ASSERT_EQ(errors.front().GetPlace().row, 1);
+    ASSERT_THROW(compiler.GetProgram(), SyntaxError);
+
+    compiler.Edit(0, 0, "\n\n");
+    ASSERT_EQ(compiler.GetErrors().front().GetPlace().row, 3);
+
+    compiler.Edit(3, 4, "y = 2\n");
+    ASSERT_TRUE(compiler.GetErrors().empty());
+
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(compiler.GetProgram(), input, output);
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(output.str(), "1\n");
+}
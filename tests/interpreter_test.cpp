@@ -0,0 +1,301 @@
+#include <lib/Compiler.h>
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+
+static std::string run(const std::string& code) {
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    EXPECT_TRUE(interpret(input, output));
+    return output.str();
+}
+
+TEST(InterpreterTestSuite, SharedProgramAcrossThreads) {
+    auto program = CompiledProgram::Compile(R"(
+        fib = function(n)
+            if n < 2 then return n end if
+            return fib(n - 1) + fib(n - 2)
+        end function
+
+        counter = 0
+        for i in range(10)
+            counter += 1
+        end for
+
+        println(fib(15))
+        print(counter)
+    )");
+
+    constexpr size_t kThreads = 8;
+    std::vector<std::ostringstream> outputs(kThreads);
+    std::vector<std::thread> threads;
+    std::vector<char> results(kThreads, false);
+
+    for (size_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i] {
+            std::istringstream input;
+            Interpreter interpreter(program, input, outputs[i]);
+            results[i] = interpreter.Run();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < kThreads; ++i) {
+        ASSERT_TRUE(results[i]);
+        ASSERT_EQ(outputs[i].str(), "610\n10");
+    }
+}
+
+TEST(InterpreterTestSuite, InstancesDoNotShareGlobals) {
+    auto program = CompiledProgram::Compile(R"(
+        x = read()
+        print(x)
+    )");
+
+    std::istringstream first_input("first\n");
+    std::istringstream second_input("second\n");
+    std::ostringstream first_output;
+    std::ostringstream second_output;
+
+    Interpreter first(program, first_input, first_output);
+    Interpreter second(program, second_input, second_output);
+
+    ASSERT_TRUE(first.Run());
+    ASSERT_TRUE(second.Run());
+    ASSERT_EQ(first_output.str(), "first");
+    ASSERT_EQ(second_output.str(), "second");
+}
+
+TEST(InterpreterTestSuite, RuntimeErrorIsReported) {
+    auto program = CompiledProgram::Compile(R"(
+        f = function(x) return x + "a" end function
+        f(1)
+        print(239)
+    )");
+
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(program, input, output);
+
+    ASSERT_FALSE(interpreter.Run());
+    ASSERT_NE(interpreter.GetError().find("in f"), std::string::npos);
+    ASSERT_EQ(output.str(), "");
+}
+
+TEST(InterpreterTestSuite, SyntaxErrorIsThrown) {
+    ASSERT_THROW(CompiledProgram::Compile("if x then print(1)"), SyntaxError);
+    ASSERT_THROW(CompiledProgram::Compile("x = (1 + 2"), SyntaxError);
+    ASSERT_THROW(CompiledProgram::Compile("break"), SyntaxError);
+}
+
+TEST(InterpreterTestSuite, NumberLiteralOutOfRange) {
+    try {
+        CompiledProgram::Compile("x = 1\ny = 1e999");
+        FAIL() << "expected a SyntaxError";
+    } catch (const SyntaxError& e) {
+        ASSERT_NE(std::string(e.what()).find("out of range"), std::string::npos);
+        ASSERT_EQ(e.GetPlace().row, 1);
+        ASSERT_EQ(e.GetPlace().column, 4);
+    }
+    ASSERT_EQ(run("print(.5 + 1.5e+1)"), "15.5");
+}
+
+TEST(InterpreterTestSuite, SlicesAndIndexing) {
+    ASSERT_EQ(run(R"(
+        s = "abcdef"
+        l = [1, 2, 3, 4]
+        print(s[1:3])
+        print(s[-1])
+        print(s[:2])
+        print(s[4:])
+        print(l[1:])
+        l[0] += 10
+        print(l[:])
+    )"), "bcfabef[2, 3, 4][11, 2, 3, 4]");
+}
+
+TEST(InterpreterTestSuite, HugeIndicesAreOutOfRange) {
+    for (const char* code : {"l = [1, 2]\nx = l[1e300]", "l = [1, 2]\nx = l[-1e300]", "x = \"ab\"[1e308 * 10]",
+                             "x = \"ab\"[-(1e308 * 10)]", "l = [1, 2]\nl[9.3e18] = 1", "x = [1][0 * (1e308 * 10)]"}) {
+        std::istringstream input;
+        std::ostringstream output;
+        Interpreter interpreter(CompiledProgram::Compile(code), input, output);
+        ASSERT_FALSE(interpreter.Run()) << code;
+        ASSERT_NE(interpreter.GetError().find("index"), std::string::npos) << interpreter.GetError();
+    }
+
+    ASSERT_EQ(run(R"(
+        inf = 1e308 * 10
+        s = "abcdef"
+        l = [1, 2, 3]
+        print(s[-1e300:2])
+        print(s[4:1e300])
+        print(l[-inf:inf])
+        print(l[inf:])
+        print(s[:-inf])
+    )"), "abef[1, 2, 3][]");
+}
+
+TEST(InterpreterTestSuite, LocalsAndGlobals) {
+    ASSERT_EQ(run(R"(
+        total = 0
+        add = function(value)
+            total = total + value
+            tmp = value * 2
+            return tmp
+        end function
+
+        add(1)
+        add(2)
+        print(total)
+    )"), "3");
+}
+
+TEST(InterpreterTestSuite, ListSlicesAreCopyOnWrite) {
+    ASSERT_EQ(run(R"(
+        l = [1, 2, 3, 4, 5]
+        a = l[1:4]
+        b = l[:]
+        push(b, 6)
+        a[0] = 20
+        println(l)
+        println(a)
+        println(b)
+        r = [1, 2, 3] * 2.5
+        println(r[2:6] * 2)
+        push(r, 9)
+        println(r)
+    )"), "[1, 2, 3, 4, 5]\n[20, 3, 4]\n[1, 2, 3, 4, 5, 6]\n[3, 1, 2, 3, 3, 1, 2, 3]\n[1, 2, 3, 1, 2, 3, 1, 9]\n");
+}
+
+TEST(InterpreterTestSuite, StringOperators) {
+    ASSERT_EQ(run(R"(
+        println("hello.is" - ".is")
+        println("ab" * 2.5)
+        println("line\tend")
+        println(not nil and "x" < "y")
+    )"), "hello\nababa\nline\tend\n1\n");
+}
+
+TEST(InterpreterTestSuite, OperatorTypeMatrix) {
+    ASSERT_EQ(run(R"(
+        println([7 % -3, 2 ^ 10, "ab" >= "b", "hello" - "x"])
+        println([2 * "ab", [1] * 2, 1.5 * [1, 2], [1] + [2]])
+        println([nil == nil, nil == 0, [1, [2]] == [1, [2]], print == print, 1 != "1"])
+    )"), "[-2, 1024, 0, \"hello\"]\n[\"abab\", [1, 1], [1, 2, 1], [1, 2]]\n[1, 0, 1, 1, 1]\n");
+
+    for (const char* code : {"1 < \"a\"", "[1] - [1]", "nil + nil", "\"a\" * \"b\"", "print + 1", "\"ab\" * 9.3e18",
+                             "1e300 * \"\"", "\"ab\" * -1"}) {
+        std::istringstream input(code);
+        std::ostringstream output;
+        ASSERT_FALSE(interpret(input, output)) << code;
+    }
+}
+
+TEST(InterpreterTestSuite, NumberFormatting) {
+    ASSERT_EQ(run(R"(
+        println(3)
+        println(-2.5)
+        println(1 / 3)
+        println(to_string(0.1 + 0.2))
+        println(2 ^ 60)
+        println([1, 0.5, "x"])
+    )"), "3\n-2.5\n0.3333333333333333\n0.30000000000000004\n1152921504606846976\n[1, 0.5, \"x\"]\n");
+}
+
+// Input that records what had been written to `output` when it was first read.
+class RecordingInput : public std::streambuf {
+public:
+    RecordingInput(std::string text, const std::ostringstream& output)
+        : text_(std::move(text))
+        , output_(output) {
+    }
+
+    std::string seen;
+
+protected:
+    auto underflow() -> int_type override {
+        if (eback() == nullptr) {
+            seen = output_.str();
+            setg(text_.data(), text_.data(), text_.data() + text_.size());
+            return traits_type::to_int_type(*gptr());
+        }
+        return traits_type::eof();
+    }
+
+private:
+    std::string text_;
+    const std::ostringstream& output_;
+};
+
+TEST(InterpreterTestSuite, OutputIsFlushedBeforeRead) {
+    std::ostringstream output;
+    RecordingInput buffer("answer\n", output);
+    std::istream input(&buffer);
+    Interpreter interpreter(CompiledProgram::Compile(R"(
+        print("question? ")
+        line = read()
+        print(line)
+    )"), input, output);
+    interpreter.GetOutputBuffer().SetThreshold(1 << 20);
+
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(buffer.seen, "question? ");
+    ASSERT_EQ(output.str(), "question? answer");
+}
+
+TEST(InterpreterTestSuite, ReadingInput) {
+    auto program = CompiledProgram::Compile(R"(
+        println(read())
+        println(len(read()))
+        rest = read_lines()
+        println(rest)
+        println(read())
+        println(read_all() == "")
+    )");
+
+    std::istringstream input("first\n\nsecond\nthird");
+    std::ostringstream output;
+    Interpreter interpreter(program, input, output);
+
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(output.str(), "first\n0\n[\"second\", \"third\"]\nnil\n1\n");
+}
+
+TEST(InterpreterTestSuite, ReadAllKeepsNewlines) {
+    std::istringstream input("a\nb\n");
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile("print(read_all())"), input, output);
+
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(output.str(), "a\nb\n");
+}
+
+TEST(InterpreterTestSuite, ParseNum) {
+    ASSERT_EQ(run(R"(
+        println(parse_num("42"))
+        println(parse_num("-1.5e3"))
+        println(parse_num("+7"))
+        println(parse_num(" 1"))
+        println(parse_num("12abc"))
+        println(parse_num(""))
+        println(parse_num(5))
+    )"), "42\n-1500\n7\nnil\nnil\nnil\nnil\n");
+}
+
+TEST(InterpreterTestSuite, HugeIntegerArgumentsFail) {
+    for (const char* code : {"insert([1], 1e300, 0)", "insert([1], -1e300, 0)", "remove([1], 1e308 * 10)",
+                             "rnd(1e300)", "rnd(1e308 * 10)", "rnd(0 * (1e308 * 10))"}) {
+        std::istringstream input;
+        std::ostringstream output;
+        Interpreter interpreter(CompiledProgram::Compile(code), input, output);
+        ASSERT_FALSE(interpreter.Run()) << code;
+    }
+
+    ASSERT_EQ(run("l = [1, 2]\ninsert(l, -1, 5)\nprint(l)\nprint(rnd(1) + rnd(9.2e18) * 0)"), "[1, 5, 2]0");
+}
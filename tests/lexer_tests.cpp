@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
 #include "Lexer.h"
+#include "WorkStealingPool.h"
 #include <sstream>
 #include <fstream>
+#include <random>
 
 class LexerTests : public ::testing::Test {
 public:
@@ -149,6 +151,49 @@ TEST_F(LexerTests, InvalidSymbol) {
     expectToken(1, TokenType::kIDENTIFIER, "y", 0, 4);
 }
 
+TEST_F(LexerTests, ParallelChunksMatchSequential) {
+    const std::vector<std::string> pool_lines = {
+        "x = 1.5e-3 + y", "s = \"open", "still open", "closed\" + s", "\"\\", "\"", "// comment \" here",
+        "if x then print(\"a\\\"b\") end if", "", "l = [1, 2][0:1]", "f = function(a) return a end function",
+    };
+
+    std::mt19937 random(7);
+    WorkStealingPool pool(4);
+    for (size_t chunk_size : {1, 16, 200, 5000}) {
+        std::string code;
+        for (int i = 0; i < 3000; ++i) {
+            code += pool_lines[random() % pool_lines.size()] + '\n';
+        }
+        code += pool_lines[random() % pool_lines.size()];
+
+        runLexer(code);
+        Lexer parallel;
+        parallel.SetWorkerPool(&pool, chunk_size);
+        parallel.LoadCode(code);
+        parallel.Parse();
+
+        const auto& result = parallel.GetTokens();
+        ASSERT_EQ(result.size(), tokens.size()) << chunk_size;
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            ASSERT_EQ(result[i].type, tokens[i].type) << i;
+            ASSERT_EQ(result[i].text, tokens[i].text) << i;
+            ASSERT_EQ(result[i].place.row, tokens[i].place.row) << i;
+            ASSERT_EQ(result[i].place.column, tokens[i].place.column) << i;
+        }
+
+        // Rows that start inside strings must be known for later edits.
+        for (int step = 0; step < 20; ++step) {
+            size_t row = random() % parallel.GetRowCount();
+            lexer.Edit(row, row, "x = 2\n");
+            parallel.Edit(row, row, "x = 2\n");
+        }
+        ASSERT_EQ(parallel.GetTokens().size(), lexer.GetTokens().size());
+        for (size_t i = 0; i < lexer.GetTokens().size(); ++i) {
+            ASSERT_EQ(parallel.GetTokens()[i].text, lexer.GetTokens()[i].text) << i;
+        }
+    }
+}
+
 class LexerFileTests : public ::testing::Test {
 public:
     Lexer lexer;
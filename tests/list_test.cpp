@@ -0,0 +1,128 @@
+#include <lib/Value.h>
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <random>
+#include <sstream>
+
+static auto to_deque(const List& list) -> std::deque<double> {
+    std::deque<double> result;
+    for (size_t i = 0; i < list.GetSize(); ++i) {
+        result.push_back(std::get<double>(list[i]));
+    }
+    return result;
+}
+
+TEST(ListTestSuite, MatchesDequeUnderRandomEdits) {
+    std::mt19937 random(239);
+    ListPtr list = std::get<ListPtr>(MakeList({}));
+    std::deque<double> expected;
+    std::vector<std::pair<ListPtr, std::deque<double>>> views;
+
+    for (int step = 0; step < 20000; ++step) {
+        auto value = static_cast<double>(step);
+        size_t size = expected.size();
+        switch (random() % 6) {
+            case 0:
+                list->Push(value);
+                expected.push_back(value);
+                break;
+            case 1:
+            case 2: {
+                // Bias towards the ends, where the layout matters.
+                size_t index = random() % 2 == 0 ? 0 : random() % (size + 1);
+                list->Insert(index, value);
+                expected.insert(expected.begin() + static_cast<std::ptrdiff_t>(index), value);
+                break;
+            }
+            case 3:
+                if (size != 0) {
+                    size_t index = random() % 2 == 0 ? 0 : random() % size;
+                    ASSERT_EQ(std::get<double>(list->Remove(index)), expected[index]);
+                    expected.erase(expected.begin() + static_cast<std::ptrdiff_t>(index));
+                }
+                break;
+            case 4:
+                if (size != 0) {
+                    ASSERT_EQ(std::get<double>(list->Pop()), expected.back());
+                    expected.pop_back();
+                }
+                break;
+            case 5:
+                if (size != 0) {
+                    size_t index = random() % size;
+                    list->Set(index, value);
+                    expected[index] = value;
+                }
+                if (step % 50 == 5) {
+                    views.emplace_back(list->Slice(0, list->GetSize()), expected);
+                }
+                break;
+        }
+        ASSERT_EQ(list->GetSize(), expected.size());
+    }
+
+    ASSERT_EQ(to_deque(*list), expected);
+    for (const auto& [view, snapshot] : views) {
+        ASSERT_EQ(to_deque(*view), snapshot);
+    }
+}
+
+TEST(ListTestSuite, ViewsSeeTheirOwnItems) {
+    ListPtr list = std::get<ListPtr>(MakeList({1.0, 2.0, 3.0, 4.0}));
+    ListPtr tail = list->Slice(1, 4);
+    ListPtr cycle = tail->Repeat(7);
+
+    list->Remove(0);
+    list->Insert(0, 10.0);
+    tail->Push(5.0);
+
+    ASSERT_EQ(to_deque(*list), (std::deque<double>{10, 2, 3, 4}));
+    ASSERT_EQ(to_deque(*tail), (std::deque<double>{2, 3, 4, 5}));
+    ASSERT_EQ(to_deque(*cycle), (std::deque<double>{2, 3, 4, 2, 3, 4, 2}));
+    ASSERT_EQ(to_deque(*cycle->Slice(2, 6)), (std::deque<double>{4, 2, 3, 4}));
+}
+
+TEST(ListTestSuite, SortPutsNanLast) {
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile(R"(
+        nan = 0 * (1e308 * 10)
+        l = []
+        for i in range(200)
+            push(l, (i * 37) % 101)
+            if i % 7 == 0 then push(l, nan) end if
+        end for
+        sort(l)
+        ok = true
+        for i in range(1, 200)
+            if not (l[i - 1] <= l[i]) then ok = false end if
+        end for
+        for i in range(200, len(l))
+            if l[i] == l[i] then ok = false end if
+        end for
+        nested = [[nan], [1], [nan, 1]]
+        sort(nested)
+        println([ok, len(l), nested[0]])
+    )"), input, output);
+
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(output.str(), "[1, 229, [1]]\n");
+}
+
+TEST(ListTestSuite, HugeRepeatCountsFail) {
+    for (const char* code : {"l = [1, 2] * 9.3e18", "l = 1e300 * [1]", "l = [1, 2] * 3e9", "l = [] * 1e20"}) {
+        std::istringstream input;
+        std::ostringstream output;
+        Interpreter interpreter(CompiledProgram::Compile(code), input, output);
+        ASSERT_FALSE(interpreter.Run()) << code;
+        ASSERT_NE(interpreter.GetError().find("repeat count too large"), std::string::npos) << interpreter.GetError();
+    }
+
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile("println(len([1, 2] * 1e9))"), input, output);
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(output.str(), "2000000000\n");
+}
@@ -0,0 +1,152 @@
+#include <lib/WorkStealingPool.h>
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+static std::string run_with_pool(const std::string& code, WorkStealingPool& pool) {
+    std::istringstream input;
+    std::ostringstream output;
+
+    Interpreter interpreter(CompiledProgram::Compile(code), input, output);
+    interpreter.SetWorkerPool(&pool);
+    EXPECT_TRUE(interpreter.Run()) << interpreter.GetError();
+
+    return output.str();
+}
+
+TEST(ParallelBuiltinsTestSuite, MapFilterReduce) {
+    WorkStealingPool pool(4);
+
+    ASSERT_EQ(run_with_pool(R"(
+        l = range(20000)
+        offset = 1
+        squares = pmap(l, function(x) return x * x + offset end function)
+        println(squares[19999] == 399960002)
+        println(len(pfilter(l, function(x) return x % 3 == 0 end function)))
+        add = function(a, b) return a + b end function
+        println(preduce(l, add, 5) == 199990005)
+        println(preduce(l, add, 0, add) == 199990000)
+        println(pmap([1, 2, 3], to_string))
+    )", pool), "1\n6667\n1\n1\n[\"1\", \"2\", \"3\"]\n");
+}
+
+TEST(ParallelBuiltinsTestSuite, ReduceMatchesSequentialFold) {
+    WorkStealingPool pool(4);
+
+    // Neither fold is a combine of two elements: without `combine` preduce
+    // must not split them, with it the parts are merged in order.
+    ASSERT_EQ(run_with_pool(R"(
+        l = range(10000)
+        println(preduce(l, function(a, x) return a + x * x end function, 0))
+        println(preduce(l, function(a, x) return a * 31 % 1000003 + x end function, 7))
+
+        digits = function(a, x) return a + to_string(x % 10) end function
+        joined = preduce(l, digits, "", function(a, b) return a + b end function)
+        expected = ""
+        for x in l
+            expected = digits(expected, x)
+        end for
+        println([joined == expected, len(joined)])
+    )", pool), "333283335000\n" + std::to_string([] {
+        long long value = 7;
+        for (long long x = 0; x < 10000; ++x) {
+            value = value * 31 % 1000003 + x;
+        }
+        return value;
+    }()) + "\n[1, 10000]\n");
+}
+
+TEST(ParallelBuiltinsTestSuite, SideEffectsFallBackToSequential) {
+    WorkStealingPool pool(4);
+
+    ASSERT_EQ(run_with_pool(R"(
+        calls = 0
+        count = function(x)
+            calls += 1
+            return x
+        end function
+        pmap(range(10000), count)
+        println(calls)
+
+        show = function(x)
+            if x % 5000 == 1 then print(x) end if
+            return x
+        end function
+        pfilter(range(10000), show)
+    )", pool), "10000\n15001");
+}
+
+TEST(ParallelBuiltinsTestSuite, ErrorsAreReportedInOrder) {
+    WorkStealingPool pool(4);
+
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile(R"(
+        bad = function(x)
+            if x == 7000 then return x + "a" end if
+            return x
+        end function
+        pmap(range(10000), bad)
+    )"), input, output);
+    interpreter.SetWorkerPool(&pool);
+
+    ASSERT_FALSE(interpreter.Run());
+    ASSERT_NE(interpreter.GetError().find("in bad"), std::string::npos);
+}
+
+TEST(ParallelBuiltinsTestSuite, WorksWithoutPool) {
+    std::istringstream input("println(preduce(range(5), function(a, b) return a * 10 + b end function, 0))");
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "1234\n");
+}
+
+TEST(ParallelBuiltinsTestSuite, WorkersChargeTheScriptsMemoryBudget) {
+    WorkStealingPool pool(4);
+    auto program = CompiledProgram::Compile(R"(
+        big = pmap(range(10000), function(x) return "ab" * 1000 + to_string(x) end function)
+        println(len(big))
+    )");
+
+    for (size_t budget : {size_t{1} << 30, size_t{1} << 20}) {
+        std::istringstream input;
+        std::ostringstream output;
+        Interpreter interpreter(program, input, output);
+        interpreter.SetWorkerPool(&pool);
+        interpreter.SetMemoryBudget(budget);
+
+        bool success = interpreter.Run();
+        ASSERT_EQ(success, budget == size_t{1} << 30) << interpreter.GetError();
+        if (success) {
+            // Every string the workers built is still held by `big`.
+            ASSERT_GE(interpreter.GetMemoryUsage(), 10000 * 2000);
+            ASSERT_EQ(output.str(), "10000\n");
+        } else {
+            ASSERT_NE(interpreter.GetError().find("memory budget"), std::string::npos) << interpreter.GetError();
+            ASSERT_EQ(output.str(), "");
+        }
+    }
+}
+
+TEST(ParallelBuiltinsTestSuite, WorkersShareTheInstructionBudget) {
+    WorkStealingPool pool(4);
+
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile(R"(
+        spin = function(x)
+            s = 0
+            for i in range(50) s += i end for
+            return s
+        end function
+        println(len(pmap(range(10000), spin)))
+    )"), input, output);
+    interpreter.SetWorkerPool(&pool);
+    interpreter.SetInstructionBudget(1000000);
+
+    ASSERT_FALSE(interpreter.Run());
+    ASSERT_NE(interpreter.GetError().find("instruction budget"), std::string::npos) << interpreter.GetError();
+    ASSERT_LE(interpreter.GetInstructionCount(), 1000000);
+}
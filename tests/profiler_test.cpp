@@ -0,0 +1,79 @@
+#include <lib/Profiler.h>
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+static const char* kFibonacci = R"(fib = function(n)
+    if n < 2 then return n end if
+    return fib(n - 1) + fib(n - 2)
+end function
+println(fib(18))
+)";
+
+TEST(ProfilerTestSuite, SamplesMapToFunctionsAndLines) {
+    std::istringstream input;
+    std::ostringstream output;
+    Profiler profiler;
+    Interpreter interpreter(CompiledProgram::Compile(kFibonacci), input, output);
+    interpreter.SetProfiler(&profiler, 100);
+
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(output.str(), "2584\n");
+    size_t expected = interpreter.GetInstructionCount() / 100;
+    ASSERT_GT(profiler.GetSampleCount(), expected * 9 / 10);
+    ASSERT_LT(profiler.GetSampleCount(), expected * 11 / 10);
+
+    std::stringstream stacks;
+    profiler.WriteCollapsed(stacks);
+    std::string line;
+    size_t total = 0;
+    while (std::getline(stacks, line)) {
+        ASSERT_TRUE(line.starts_with("main:5:")) << line;
+        total += std::stoul(line.substr(line.rfind(' ') + 1));
+    }
+    ASSERT_EQ(total, profiler.GetSampleCount());
+
+    // Almost every sample is in fib, below a call on line 3.
+    std::stringstream table;
+    profiler.WriteLineTable(table);
+    std::getline(table, line);
+    bool found = false;
+    while (std::getline(table, line)) {
+        std::istringstream row(line);
+        size_t self, total, number;
+        double self_percent, total_percent;
+        std::string function;
+        row >> self >> self_percent >> total >> total_percent >> number >> function;
+        if (number == 3) {
+            ASSERT_EQ(function, "fib");
+            ASSERT_GT(total_percent, 95);
+            found = true;
+        }
+    }
+    ASSERT_TRUE(found) << table.str();
+}
+
+TEST(ProfilerTestSuite, SamplingKeepsSlicesAndBudgets) {
+    auto program = CompiledProgram::Compile(kFibonacci);
+    std::istringstream input;
+    std::ostringstream output;
+    Profiler profiler;
+    Interpreter interpreter(program, input, output);
+    interpreter.SetProfiler(&profiler, 10);
+
+    interpreter.Start();
+    size_t slices = 1;
+    while (interpreter.Resume(1000) == ExecutionStatus::kSuspended) {
+        ++slices;
+    }
+    ASSERT_EQ(output.str(), "2584\n");
+    ASSERT_EQ(slices, interpreter.GetInstructionCount() / 1000 + 1);
+    ASSERT_GT(profiler.GetSampleCount(), 0);
+
+    Interpreter limited(program, input, output);
+    limited.SetProfiler(&profiler, 7);
+    limited.SetInstructionBudget(5000);
+    ASSERT_FALSE(limited.Run());
+    ASSERT_EQ(limited.GetInstructionCount(), 5000);
+}
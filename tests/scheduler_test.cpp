@@ -0,0 +1,202 @@
+#include <lib/Bytecode.h>
+#include <lib/Scheduler.h>
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory_resource>
+#include <sstream>
+
+TEST(SchedulerTestSuite, ResumeInSmallSlices) {
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile(R"(
+        fib = function(n)
+            if n < 2 then return n end if
+            return fib(n - 1) + fib(n - 2)
+        end function
+        println(fib(15))
+    )"), input, output);
+
+    interpreter.Start();
+    size_t slices = 1;
+    while (interpreter.Resume(7) == ExecutionStatus::kSuspended) {
+        ++slices;
+    }
+
+    ASSERT_EQ(output.str(), "610\n");
+    ASSERT_GT(slices, 100);
+    ASSERT_EQ(interpreter.Resume(7), ExecutionStatus::kFinished);
+}
+
+TEST(SchedulerTestSuite, InstructionBudget) {
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile("while true\nend while"), input, output);
+    interpreter.SetInstructionBudget(1000);
+
+    ASSERT_FALSE(interpreter.Run());
+    ASSERT_NE(interpreter.GetError().find("instruction budget"), std::string::npos);
+    ASSERT_EQ(interpreter.GetInstructionCount(), 1000);
+}
+
+TEST(SchedulerTestSuite, MemoryBudget) {
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile(R"(
+        s = "ab"
+        l = []
+        while true
+            s = s + s
+            push(l, s)
+        end while
+    )"), input, output);
+    interpreter.SetMemoryBudget(1 << 20);
+
+    ASSERT_FALSE(interpreter.Run());
+    ASSERT_NE(interpreter.GetError().find("memory budget"), std::string::npos);
+}
+
+TEST(SchedulerTestSuite, MemoryIsGivenBack) {
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile(R"(
+        for i in range(1000)
+            l = []
+            for j in range(100) push(l, "item" * 10) end for
+        end for
+        l = nil
+    )"), input, output);
+    interpreter.SetMemoryBudget(1 << 20);
+
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(interpreter.GetMemoryUsage(), 0);
+}
+
+TEST(SchedulerTestSuite, ListViewsShareCharges) {
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile(R"(
+        l = range(10000)
+        views = []
+        for i in range(1000) push(views, l[i:]) end for
+        big = l * 1000
+        println(len(big))
+        push(views[999], 1)
+        println(len(views[999]))
+    )"), input, output);
+    interpreter.SetMemoryBudget(1 << 20);
+
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(output.str(), "10000000\n9002\n");
+}
+
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t live_bytes = 0;
+    size_t peak_bytes = 0;
+
+private:
+    auto do_allocate(size_t bytes, size_t alignment) -> void* override {
+        ++allocations;
+        live_bytes += bytes;
+        peak_bytes = std::max(peak_bytes, live_bytes);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        live_bytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override {
+        return this == &other;
+    }
+};
+
+TEST(SchedulerTestSuite, ValuesComeFromInterpreterResource) {
+    auto program = CompiledProgram::Compile(R"(
+        words = split("a b c d e f", " ")
+        s = ""
+        for w in words s = s + upper(w) * 3 end for
+        l = range(100)[10:] + [s]
+        println(join(pmap(words, function(w) return w + "!" end function), ","))
+        println(len(l))
+        println(s[2:5])
+    )");
+
+    CountingResource resource;
+    std::istringstream input;
+    std::ostringstream output;
+    {
+        Interpreter interpreter(program, input, output, &resource);
+        // Anything that escapes the interpreter's resource fails loudly.
+        std::pmr::memory_resource* previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+        bool success = interpreter.Run();
+        std::pmr::set_default_resource(previous);
+        ASSERT_TRUE(success) << interpreter.GetError();
+    }
+
+    ASSERT_EQ(output.str(), "a!,b!,c!,d!,e!,f!\n91\nABB\n");
+    ASSERT_GT(resource.allocations, 0);
+    ASSERT_EQ(resource.live_bytes, 0);
+}
+
+TEST(SchedulerTestSuite, BudgetStopsValuesBeforeTheyAreAllocated) {
+    for (const char* code : {
+             "x = range(0, 300000000)",
+             "x = \"ab\" * 100000000",
+             "s = \"ab\" * 400000\nx = s + s",
+             "l = range(1000) * 100000\nx = l + l",
+             "x = join(range(1000) * 2000, \",\")",
+             "x = split(\"a\" * 900000, \"\")",
+             "x = split(\"a,\" * 400000, \",\")",
+             "x = pmap(range(1000) * 100000, abs)",
+         }) {
+        CountingResource resource;
+        std::istringstream input;
+        std::ostringstream output;
+        Interpreter interpreter(CompiledProgram::Compile(code), input, output, &resource);
+        interpreter.SetMemoryBudget(1 << 20);
+
+        ASSERT_FALSE(interpreter.Run()) << code;
+        ASSERT_NE(interpreter.GetError().find("memory budget"), std::string::npos) << interpreter.GetError();
+        ASSERT_LT(resource.peak_bytes, 4 << 20) << code;
+    }
+}
+
+TEST(SchedulerTestSuite, RunawayScriptsDoNotBlockOthers) {
+    auto runaway = CompiledProgram::Compile("while true\nend while");
+    auto counter = CompiledProgram::Compile(R"(
+        sum = 0
+        for i in range(1000) sum += i end for
+        println(sum == 499500)
+    )");
+
+    constexpr size_t kScripts = 200;
+    std::istringstream input;
+    std::vector<std::ostringstream> outputs(kScripts);
+    std::vector<ScriptOutcome> outcomes(kScripts);
+    {
+        Scheduler scheduler(2);
+        ScriptLimits limits;
+        limits.time_slice = 500;
+        limits.max_instructions = 1000000;
+        for (size_t i = 0; i < kScripts; ++i) {
+            scheduler.Spawn(i % 10 == 0 ? runaway : counter, input, outputs[i], limits,
+                            [&outcomes, i](const ScriptOutcome& outcome) { outcomes[i] = outcome; });
+        }
+        scheduler.Wait();
+    }
+
+    for (size_t i = 0; i < kScripts; ++i) {
+        if (i % 10 == 0) {
+            ASSERT_FALSE(outcomes[i].success);
+            ASSERT_NE(outcomes[i].error.find("instruction budget"), std::string::npos);
+        } else {
+            ASSERT_TRUE(outcomes[i].success) << outcomes[i].error;
+            ASSERT_EQ(outputs[i].str(), "1\n");
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#include <lib/StringAlgorithms.h>
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+
+TEST(StringAlgorithmsTestSuite, FindMatchesStdFind) {
+    std::mt19937 random(42);
+    for (size_t round = 0; round < 2000; ++round) {
+        std::string haystack(random() % 200, ' ');
+        for (char& c : haystack) {
+            c = static_cast<char>('a' + random() % 3);
+        }
+        std::string needle(1 + random() % 5, ' ');
+        for (char& c : needle) {
+            c = static_cast<char>('a' + random() % 3);
+        }
+        size_t from = random() % (haystack.size() + 2);
+
+        ASSERT_EQ(FindSubstring(haystack, needle, from), std::string_view(haystack).find(needle, from))
+            << haystack << " / " << needle << " / " << from;
+    }
+}
+
+TEST(StringAlgorithmsTestSuite, CaseConversion) {
+    std::string text;
+    for (int c = 0; c < 256; ++c) {
+        text += static_cast<char>(c);
+    }
+    text += text;
+
+    std::string lower = text;
+    std::string upper = text;
+    AsciiToLower(lower.data(), lower.size());
+    AsciiToUpper(upper.data(), upper.size());
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        ASSERT_EQ(static_cast<unsigned char>(lower[i]), c >= 'A' && c <= 'Z' ? c + 32 : c);
+        ASSERT_EQ(static_cast<unsigned char>(upper[i]), c >= 'a' && c <= 'z' ? c - 32 : c);
+    }
+}
+
+TEST(StringAlgorithmsTestSuite, StringBuiltins) {
+    std::istringstream input(R"(
+        println(split("a, b,, c", ", "))
+        println(split("abc", ""))
+        println(split("abc", "x"))
+        println(split("", ","))
+        println(join(["a", 1, [2], nil], "-"))
+        println(join([], "-") == "")
+        println(replace("aaaa", "aa", "b"))
+        println(replace("Hello World, hello world!", "world", "ITMO"))
+        println(upper("Mixed Case 123 long enough for vectors"))
+        println(lower("Mixed Case 123 LONG ENOUGH FOR VECTORS"))
+    )");
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(),
+              "[\"a\", \"b,\", \"c\"]\n"
+              "[\"a\", \"b\", \"c\"]\n"
+              "[\"abc\"]\n"
+              "[\"\"]\n"
+              "a-1-[2]-nil\n"
+              "1\n"
+              "bb\n"
+              "Hello World, hello ITMO!\n"
+              "MIXED CASE 123 LONG ENOUGH FOR VECTORS\n"
+              "mixed case 123 long enough for vectors\n");
+}
+
+TEST(StringAlgorithmsTestSuite, SplitPartsShareTheSource) {
+    std::istringstream input;
+    std::ostringstream output;
+    Interpreter interpreter(CompiledProgram::Compile(R"(
+        line = "0123456789abcdefghij" * 50 + ";"
+        text = line * 1000
+        parts = split(text, ";")
+        println(len(parts))
+        println(parts[7] == line[:1000])
+        halves = split(parts[3], "j")
+        println([len(halves), len(halves[1]), halves[1][:3]])
+    )"), input, output);
+    interpreter.SetMemoryBudget(1 << 30);
+
+    ASSERT_TRUE(interpreter.Run()) << interpreter.GetError();
+    ASSERT_EQ(output.str(), "1001\n1\n[51, 19, \"012\"]\n");
+    // The 1 MB source is alive, but its 1000 parts added no copy of it.
+    ASSERT_LT(interpreter.GetMemoryUsage(), 1500000);
+}
+
+TEST(StringAlgorithmsTestSuite, ScanText) {
+    std::string long_ascii(100, 'a');
+    ASSERT_EQ(ScanText(long_ascii).code_points, 100);
+    ASSERT_TRUE(ScanText(long_ascii).ascii);
+
+    std::string mixed = long_ascii + "привет, 世界" + long_ascii;
+    TextInfo info = ScanText(mixed);
+    ASSERT_FALSE(info.ascii);
+    ASSERT_EQ(info.code_points, 210);
+    ASSERT_EQ(CodePointOffset(mixed, 101), 102);
+    ASSERT_EQ(CodePointOffset(mixed, 210), mixed.size());
+
+    ASSERT_EQ(ScanText("\x80\x80z").code_points, 2);
+}
+
+TEST(StringAlgorithmsTestSuite, Utf8Strings) {
+    std::istringstream input(R"(
+        s = "привет, мир"
+        println(len(s))
+        println(s[0] + s[-1])
+        println(s[8:])
+        println(s * 1.5)
+        for c in "añb" print(c + "|") end for
+        println()
+        println(split("añb", ""))
+        println(len("plain"))
+    )");
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(),
+              "11\n"
+              "пр\n"
+              "мир\n"
+              "привет, мирприве\n"
+              "a|ñ|b|\n"
+              "[\"a\", \"ñ\", \"b\"]\n"
+              "5\n");
+}
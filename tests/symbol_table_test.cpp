@@ -0,0 +1,44 @@
+#include <lib/SymbolTable.h>
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+TEST(SymbolTableTestSuite, InternIsStableAndDense) {
+    SymbolTable symbols;
+
+    ASSERT_EQ(symbols.Intern("x"), 0);
+    ASSERT_EQ(symbols.Intern("print"), 1);
+    ASSERT_EQ(symbols.Intern("x"), 0);
+    ASSERT_EQ(symbols.GetSize(), 2);
+    ASSERT_EQ(symbols.GetName(1), "print");
+    ASSERT_EQ(symbols.Find("print"), 1);
+    ASSERT_FALSE(symbols.Find("y").has_value());
+}
+
+TEST(SymbolTableTestSuite, SurvivesRehash) {
+    SymbolTable symbols;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        ASSERT_EQ(symbols.Intern("name" + std::to_string(i)), i);
+    }
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        ASSERT_EQ(symbols.Find("name" + std::to_string(i)), i);
+    }
+    ASSERT_EQ(symbols.GetSize(), 1000);
+}
+
+TEST(SymbolTableTestSuite, GlobalsAndBuiltinsResolveBySymbol) {
+    std::istringstream input(R"(
+        f = function() return g + 1 end function
+        g = 41
+        println(f())
+        println = 5
+        print(println)
+        print(undefined_name)
+    )");
+    std::ostringstream output;
+
+    ASSERT_FALSE(interpret(input, output));
+    ASSERT_EQ(output.str(), "42\n5");
+}
@@ -0,0 +1,86 @@
+#include <lib/WorkStealingPool.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+
+TEST(WorkStealingPoolTestSuite, RunsAllTasks) {
+    std::atomic<size_t> counter = 0;
+
+    WorkStealingPool pool(4);
+    for (size_t i = 0; i < 1000; ++i) {
+        pool.Submit([&counter] { ++counter; });
+    }
+    pool.Wait();
+
+    ASSERT_EQ(counter, 1000);
+}
+
+TEST(WorkStealingPoolTestSuite, TasksCanSubmitTasks) {
+    std::atomic<size_t> counter = 0;
+
+    WorkStealingPool pool(3);
+    for (size_t i = 0; i < 10; ++i) {
+        pool.Submit([&pool, &counter] {
+            for (size_t j = 0; j < 10; ++j) {
+                pool.Submit([&counter] { ++counter; });
+            }
+        });
+    }
+    pool.Wait();
+
+    ASSERT_EQ(counter, 100);
+}
+
+TEST(WorkStealingPoolTestSuite, CanBeReusedAfterWait) {
+    std::atomic<size_t> counter = 0;
+
+    WorkStealingPool pool(2);
+    pool.Submit([&counter] { ++counter; });
+    pool.Wait();
+    pool.Submit([&counter] { ++counter; });
+    pool.Wait();
+
+    ASSERT_EQ(counter, 2);
+    ASSERT_EQ(pool.GetThreadCount(), 2);
+}
+
+TEST(WorkStealingPoolTestSuite, TaskExceptionsReachWait) {
+    std::atomic<size_t> counter = 0;
+
+    WorkStealingPool pool(2);
+    pool.Submit([] { throw std::runtime_error("task failed"); });
+    for (size_t i = 0; i < 100; ++i) {
+        pool.Submit([&counter] { ++counter; });
+    }
+    ASSERT_THROW(pool.Wait(), std::runtime_error);
+    ASSERT_EQ(counter, 100);
+
+    pool.Submit([&counter] { ++counter; });
+    pool.Wait();
+    ASSERT_EQ(counter, 101);
+}
+
+TEST(WorkStealingPoolTestSuite, WaitForNestedTasks) {
+    std::atomic<size_t> counter = 0;
+    std::atomic<size_t> outer = 8;
+
+    WorkStealingPool pool(2);
+    for (size_t i = 0; i < 8; ++i) {
+        pool.Submit([&pool, &counter, &outer] {
+            std::atomic<size_t> inner = 50;
+            for (size_t j = 0; j < 50; ++j) {
+                pool.Submit([&counter, &inner] {
+                    ++counter;
+                    inner.fetch_sub(1);
+                });
+            }
+            pool.WaitFor(inner);
+            outer.fetch_sub(1);
+        });
+    }
+    pool.WaitFor(outer);
+
+    ASSERT_EQ(counter, 400);
+    pool.Wait();
+}